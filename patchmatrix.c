@@ -18,6 +18,7 @@
 #include <sys/wait.h>
 
 #include <patchmatrix.h>
+#include <patchmatrix_db.h>
 #include <patchmatrix_jack.h>
 #include <patchmatrix_nk.h>
 
@@ -56,6 +57,9 @@ main(int argc, char **argv)
 	app.nxt_default = 30;
 
 	app.server_name = NULL;
+	app.hosted = false;
+	app.metered = false;
+	app.host_shm = NULL;
 
 	fprintf(stderr,
 		"%s "PATCHMATRIX_VERSION"\n"
@@ -63,7 +67,7 @@ main(int argc, char **argv)
 		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
 
 	int c;
-	while((c = getopt(argc, argv, "vhn:")) != -1)
+	while((c = getopt(argc, argv, "vhHpn:")) != -1)
 	{
 		switch(c)
 		{
@@ -92,9 +96,17 @@ main(int argc, char **argv)
 					"OPTIONS\n"
 					"   [-v]                 print version and full license information\n"
 					"   [-h]                 print usage information\n"
+					"   [-H]                 spawn mixers and monitors in a shared host\n"
+					"   [-p]                 spawn mixers that meter peaks of their inputs and outputs\n"
 					"   [-n] server-name     connect to named JACK daemon\n\n"
 					, argv[0]);
 				return 0;
+			case 'H':
+				app.hosted = true;
+				break;
+			case 'p':
+				app.metered = true;
+				break;
 			case 'n':
 				app.server_name = optarg;
 				break;
@@ -145,6 +157,9 @@ main(int argc, char **argv)
 cleanup:
 	_jack_deinit(&app);
 
+	if(app.host_shm)
+		_host_free(app.host_shm);
+
 	if(app.from_jack)
 	{
 		_jack_anim(&app); // drain ringbuffer
@@ -27,6 +27,8 @@
 #include <signal.h>
 #include <string.h>
 #include <semaphore.h>
+#include <stdatomic.h>
+#include <stdalign.h>
 
 #include <jack/jack.h>
 #include <jack/midiport.h>
@@ -41,6 +43,18 @@
 
 #include <varchunk.h>
 
+#if defined(__SSE2__)
+#	include <immintrin.h>
+#	define MONITOR_SSE
+#	if defined(__GNUC__) // AVX kernels are compiled in and picked at runtime
+#		define MONITOR_AVX
+#		define MONITOR_FMA
+#	endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#	include <arm_neon.h>
+#	define MONITOR_NEON
+#endif
+
 #define NK_PUGL_API
 #include <nk_pugl/nk_pugl.h>
 
@@ -60,22 +74,63 @@
 
 #define PATCHMATRIX_MIXER            "patchmatrix_mixer"
 #define PATCHMATRIX_MONITOR          "patchmatrix_monitor"
+#define PATCHMATRIX_HOST             "patchmatrix_host"
 
 #define PATCHMATRIX_MIXER_ID          "/"PATCHMATRIX_MIXER
 #define PATCHMATRIX_MONITOR_ID        "/"PATCHMATRIX_MONITOR
-
-#define PORT_MAX 128
+#define PATCHMATRIX_HOST_ID           "/"PATCHMATRIX_HOST
+
+#define PORT_MAX 1024 // sanity limit, instances are sized dynamically
+#define NAME_MAX_LEN 64 // of JACK client and shm segment names
+#define HOST_REQUEST_MAX 32 // pending requests to spawn instances in host
+
+#define SHM_VERSION 12 // bump on any change of the shared memory layout
+#define SHM_CACHE_LINE 64
+#define MONITOR_SLOTS 2 // values published per monitored sink
+#define MONITOR_HISTORY 256 // entries of level history per monitored sink
+#define MONITOR_HISTORY_RATE 50 // entries per second
+#define MONITOR_BANDS 32 // log-spaced bands of spectrum per monitored sink
+#define MONITOR_POINTS 128 // recent frames per correlated pair of sinks, for goniometer
+#define MONITOR_EVENTS 32 // recent raw events per monitored MIDI sink
+#define MONITOR_EVENT_SIZE 8 // bytes kept of each recent event, longer ones are cut short
+#define MONITOR_KINDS 8 // of MIDI events counted, channel messages 0x8n to 0xEn, then system
+#define MONITOR_SYSTEM 16 // bit of system messages in channel bitmap
+#define MONITOR_PATHS 8 // recent paths per monitored OSC sink
+#define MONITOR_PATH_SIZE 60 // bytes kept of each recent path, longer ones are cut short
+#define MONITOR_CV_BLOCKS 8 // recent blocks per monitored CV sink
+#define MONITOR_LANES 4 // sinks scanned in one pass
 
 typedef enum _event_type_t event_type_t;
 typedef enum _port_type_t port_type_t;
 typedef enum _port_designation_t port_designation_t;
+typedef enum _sync_state_t sync_state_t;
+typedef enum _host_kind_t host_kind_t;
+typedef enum _host_slot_t host_slot_t;
+typedef enum _monitor_mode_t monitor_mode_t;
+typedef struct _monitor_stats_t monitor_stats_t;
+
+typedef void (*monitor_scan_t)(const float *const *psinks,
+	jack_nframes_t nframes, monitor_stats_t *stats);
 
 typedef struct _hash_t hash_t;
 typedef struct _port_conn_t port_conn_t;
 typedef struct _client_conn_t client_conn_t;
 typedef struct _port_t port_t;
+typedef struct _shm_header_t shm_header_t;
 typedef struct _mixer_shm_t mixer_shm_t;
+typedef struct _monitor_history_t monitor_history_t;
+typedef struct _monitor_pair_t monitor_pair_t;
+typedef struct _monitor_event_t monitor_event_t;
+typedef struct _monitor_midi_t monitor_midi_t;
+typedef struct _monitor_path_t monitor_path_t;
+typedef struct _monitor_osc_t monitor_osc_t;
+typedef struct _monitor_block_t monitor_block_t;
+typedef struct _monitor_cv_t monitor_cv_t;
+typedef union _monitor_sink_t monitor_sink_t;
+typedef struct _monitor_rate_t monitor_rate_t;
 typedef struct _monitor_shm_t monitor_shm_t;
+typedef struct _host_request_t host_request_t;
+typedef struct _host_shm_t host_shm_t;
 typedef struct _client_t client_t;
 typedef struct _app_t app_t;
 typedef struct _event_t event_t;
@@ -108,6 +163,35 @@ enum _port_type_t {
 #endif
 };
 
+enum _sync_state_t {
+	SYNC_NONE = 0, // RT thread runs freely
+	SYNC_FREEZE, // main thread asks RT thread to leave shm alone
+	SYNC_FROZEN, // RT thread acknowledged freeze
+	SYNC_SWAP // main thread has prepared new state for RT thread
+};
+
+enum _host_kind_t {
+	HOST_MIXER = 0,
+	HOST_MONITOR
+};
+
+enum _host_slot_t {
+	HOST_SLOT_FREE = 0,
+	HOST_SLOT_BUSY, // claimed by UI, being filled in
+	HOST_SLOT_READY // to be picked up by host
+};
+
+enum _monitor_mode_t {
+	MONITOR_PEAK = 0, // sample peak
+	MONITOR_RMS, // 300 ms mean square, sample peak
+	MONITOR_LUFS, // K-weighted 400 ms momentary and 3 s short-term mean square
+	MONITOR_TRUE_PEAK, // 4x oversampled peak, sample peak
+	MONITOR_SPECTRUM, // sample peak, spectrum from worker thread
+	MONITOR_CORRELATION, // sample peak, correlation and balance of paired sinks
+
+	MONITOR_MAX
+};
+
 enum _port_designation_t {
 	DESIGNATION_NONE	= 0,
 	DESIGNATION_LEFT,
@@ -146,19 +230,137 @@ struct _client_conn_t {
 	bool moving;
 };
 
+#define MIXER_CV_UNITY 1000 // CV gains are linear and bipolar, in per-mille
+#define MIXER_SCENE_MAX 8 // scene slots per mixer
+#define MIXER_BANKS (2 + MIXER_SCENE_MAX) // live and idle gain matrix, then scenes
+#define MIXER_SCENE_STORE 0x8000 // flag of scene request to store instead of recall
+#define MIXER_FADE_MAX 0xffff // longest scene crossfade in ms
+
+struct _shm_header_t {
+	uint32_t version;
+	uint32_t size; // of whole segment in bytes, only ever grows
+	port_type_t type;
+	uint32_t nsinks;
+	uint32_t nsources;
+};
+
 struct _mixer_shm_t {
-	sem_t done;
-	atomic_bool closing;
-	unsigned nsinks;
-	unsigned nsources;
-	atomic_int jgains [PORT_MAX][PORT_MAX];
+	shm_header_t header; // only rewritten while gen is odd
+	bool metered; // peaks of sinks and sources are held, fixed for lifetime of mixer
+	alignas(SHM_CACHE_LINE) sem_t done; // posted by UI or for resize
+	alignas(SHM_CACHE_LINE) atomic_bool closing; // polled by RT thread
+	alignas(SHM_CACHE_LINE) atomic_uint gen; // odd while resizing
+	atomic_uint resize; // requested nsinks << 16 | nsources, 0 if none
+	alignas(SHM_CACHE_LINE) atomic_uint scene; // requested fade << 16 | flags | slot + 1, 0 if none
+	atomic_uint stored; // bitmask of scene slots stored so far
+	atomic_uint current; // last recalled or stored slot + 1, 0 if none
+	alignas(SHM_CACHE_LINE) atomic_uint bank; // live gain matrix, only flipped by RT thread
+	atomic_uint flip; // idle gain matrix is ready to be flipped to
+	atomic_uint fade; // crossfade length of pending flip in frames
+	alignas(SHM_CACHE_LINE) atomic_int jgains []; // [MIXER_BANKS][nsources][nsinks]
+	// followed by atomic_int [nsinks + nsources] held peaks of sinks, then sources
+};
+
+// one entry of level history, linear sample values
+struct _monitor_history_t {
+	float min;
+	float max;
+	float rms;
+};
+
+// correlated pair of sinks
+struct _monitor_pair_t {
+	uint32_t left; // sink, only rewritten while gen is odd
+	uint32_t right; // sink, only rewritten while gen is odd
+	float correlation; // of last block, -1 to 1, 0 if silent
+	float balance; // of last block, -1: left only to 1: right only
+	float points [MONITOR_POINTS][2]; // left and right of recent frames, in no order
+};
+
+// raw MIDI event as received
+struct _monitor_event_t {
+	uint32_t time; // in frames, as of JACK frame time
+	uint32_t size; // of whole event in bytes
+	uint8_t data [MONITOR_EVENT_SIZE];
+};
+
+// statistics of a MIDI sink, counters run since monitor started and wrap around
+struct _monitor_midi_t {
+	atomic_uint events; // received, bumped by RT thread after writing each to ring
+	atomic_uint bytes; // received
+	atomic_uint kinds [MONITOR_KINDS]; // events received per kind
+	atomic_uint channels; // bitmap of active channels and system, taken by UI
+	monitor_event_t ring [MONITOR_EVENTS]; // event n at n % MONITOR_EVENTS
+};
+
+// path of OSC message as received
+struct _monitor_path_t {
+	uint32_t time; // in frames, as of JACK frame time
+	char path [MONITOR_PATH_SIZE]; // zero terminated
+};
+
+// statistics of an OSC sink, counters run since monitor started and wrap around
+struct _monitor_osc_t {
+	atomic_uint messages; // received, bumped by RT thread after writing path of each to ring
+	atomic_uint bytes; // of packets received
+	atomic_uint bundles; // received, nested ones included
+	atomic_uint errors; // packets neither bundle nor message
+	monitor_path_t ring [MONITOR_PATHS]; // path of message n at n % MONITOR_PATHS
+};
+
+// CV of a sink over one block
+struct _monitor_block_t {
+	float min;
+	float max;
+	float mean;
+};
+
+// statistics of a CV sink
+struct _monitor_cv_t {
+	atomic_uint blocks; // written so far, bumped by RT thread after writing each to ring
+	monitor_block_t ring [MONITOR_CV_BLOCKS]; // block n at n % MONITOR_CV_BLOCKS
+};
+
+// statistics of a sink as of monitor type
+union _monitor_sink_t {
+	monitor_midi_t midi;
+	monitor_osc_t osc;
+	monitor_cv_t cv;
 };
 
 struct _monitor_shm_t {
-	sem_t done;
-	atomic_bool closing;
-	unsigned nsinks;
-	atomic_int jgains [PORT_MAX];
+	shm_header_t header; // only rewritten while gen is odd
+	monitor_mode_t mode; // fixed for lifetime of monitor
+	uint32_t npairs; // of correlated sinks, only rewritten while gen is odd
+	alignas(SHM_CACHE_LINE) sem_t done; // posted by UI or for resize
+	alignas(SHM_CACHE_LINE) atomic_bool closing; // polled by RT thread
+	alignas(SHM_CACHE_LINE) atomic_uint gen; // odd while resizing
+	atomic_uint resize; // requested nsinks << 16, 0 if none
+	atomic_bool repair; // requested pairing of sinks anew
+	alignas(SHM_CACHE_LINE) atomic_uint seq; // bumped by RT thread after each cycle
+	alignas(SHM_CACHE_LINE) atomic_uint history; // entries written so far, published by RT thread
+	alignas(SHM_CACHE_LINE) atomic_uint spectrum; // bumped by worker before and after publishing, odd meanwhile
+	alignas(SHM_CACHE_LINE) atomic_int jgains []; // [nsinks][MONITOR_SLOTS] held level or velocity, taken by UI
+	// followed by monitor_history_t [nsinks][MONITOR_HISTORY] on its own cache lines
+	// followed by float [nsinks][MONITOR_BANDS] peak amplitude per band on its own cache lines
+	// followed by monitor_pair_t [nsinks/2] on its own cache lines
+	// followed by monitor_sink_t [nsinks] on its own cache lines
+};
+
+struct _host_request_t {
+	atomic_uint slot;
+	host_kind_t kind;
+	port_type_t type;
+	uint32_t nsinks;
+	uint32_t nsources;
+	bool metered; // mixers only
+};
+
+struct _host_shm_t {
+	shm_header_t header;
+	alignas(SHM_CACHE_LINE) sem_t done; // posted by UI or by finished instances
+	alignas(SHM_CACHE_LINE) atomic_bool closing;
+	alignas(SHM_CACHE_LINE) host_request_t requests [HOST_REQUEST_MAX];
 };
 
 struct _port_t {
@@ -202,8 +404,30 @@ struct _client_t {
 
 	mixer_shm_t *mixer_shm;
 	monitor_shm_t *monitor_shm;
+	size_t shm_size; // of current mapping
+	bool hosted; // instance of a host, no JACK client of its own
 	port_type_t sink_type;
 	port_type_t source_type;
+
+	float *levels; // [nlevels] monitor or mixer meters in dBFS+6 or velocity, decayed by UI
+	unsigned nlevels;
+	uint32_t seq; // of monitor cycle peaks have last been taken at
+	double stamp; // of last meter update in s
+	float *bands; // [2][nsinks][MONITOR_BANDS] spectrum in dBFS decayed by UI, then copy of shm
+	unsigned nbands;
+	uint32_t spectrum; // of spectrum last taken
+	monitor_rate_t *rates; // [nrates] MIDI or OSC statistics of sinks
+	unsigned nrates;
+	double rated; // stamp of last rate update in s
+};
+
+// MIDI or OSC statistics of a sink as shown by UI
+struct _monitor_rate_t {
+	uint32_t events; // or messages, counted at last rate update
+	uint32_t bytes;
+	float event_rate; // per s
+	float byte_rate;
+	float channels [MONITOR_SYSTEM + 1]; // activity decayed by UI
 };
 
 struct _event_t {
@@ -267,6 +491,7 @@ struct _app_t {
 	int32_t buffer_size;
 	int32_t sample_rate;
 	int32_t xruns;
+	uint32_t scene_fade; // crossfade length of scene recalls in ms
 
 	// JACK
 	jack_client_t *client;
@@ -278,6 +503,9 @@ struct _app_t {
 	varchunk_t *from_jack;
 
 	const char *server_name;
+	bool hosted; // spawn mixers and monitors in a shared host
+	bool metered; // spawn mixers that hold peaks of their sinks and sources
+	host_shm_t *host_shm;
 
 	nk_pugl_window_t win;
 
@@ -473,6 +701,602 @@ _mkdirp(const char* path, mode_t mode)
 	return ret;
 }
 
+static size_t
+_mixer_shm_size(uint32_t nsinks, uint32_t nsources)
+{
+	return sizeof(mixer_shm_t) + MIXER_BANKS*nsinks*nsources*sizeof(atomic_int)
+		+ (nsinks + nsources)*sizeof(atomic_int);
+}
+
+static inline size_t
+_monitor_shm_history_offset(uint32_t nsinks)
+{
+	const size_t size = sizeof(monitor_shm_t) + nsinks*MONITOR_SLOTS*sizeof(atomic_int);
+
+	return (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+}
+
+static inline size_t
+_monitor_shm_spectrum_offset(uint32_t nsinks)
+{
+	const size_t size = _monitor_shm_history_offset(nsinks)
+		+ nsinks*MONITOR_HISTORY*sizeof(monitor_history_t);
+
+	return (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+}
+
+static inline size_t
+_monitor_shm_pairs_offset(uint32_t nsinks)
+{
+	const size_t size = _monitor_shm_spectrum_offset(nsinks)
+		+ nsinks*MONITOR_BANDS*sizeof(float);
+
+	return (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+}
+
+static inline size_t
+_monitor_shm_sinks_offset(uint32_t nsinks)
+{
+	const size_t size = _monitor_shm_pairs_offset(nsinks)
+		+ nsinks/2*sizeof(monitor_pair_t);
+
+	return (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+}
+
+static size_t
+_monitor_shm_size(uint32_t nsinks)
+{
+	return _monitor_shm_sinks_offset(nsinks)
+		+ nsinks*sizeof(monitor_sink_t);
+}
+
+// single producer ring, RT thread writes entry history % MONITOR_HISTORY next
+static inline monitor_history_t *
+_monitor_shm_history(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	monitor_history_t *history = (void *)((uint8_t *)shm + _monitor_shm_history_offset(nsinks));
+
+	return &history[sink*MONITOR_HISTORY];
+}
+
+// written by spectrum worker under shm->spectrum
+static inline float *
+_monitor_shm_spectrum(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	float *bands = (void *)((uint8_t *)shm + _monitor_shm_spectrum_offset(nsinks));
+
+	return &bands[sink*MONITOR_BANDS];
+}
+
+// correlation and points written by RT thread at block boundaries
+static inline monitor_pair_t *
+_monitor_shm_pair(monitor_shm_t *shm, uint32_t nsinks, uint32_t pair)
+{
+	monitor_pair_t *pairs = (void *)((uint8_t *)shm + _monitor_shm_pairs_offset(nsinks));
+
+	return &pairs[pair];
+}
+
+static inline monitor_sink_t *
+_monitor_shm_sink(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	monitor_sink_t *sinks = (void *)((uint8_t *)shm + _monitor_shm_sinks_offset(nsinks));
+
+	return &sinks[sink];
+}
+
+// written by RT thread only, channels are taken by UI
+static inline monitor_midi_t *
+_monitor_shm_midi(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	return &_monitor_shm_sink(shm, nsinks, sink)->midi;
+}
+
+// written by RT thread only
+static inline monitor_osc_t *
+_monitor_shm_osc(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	return &_monitor_shm_sink(shm, nsinks, sink)->osc;
+}
+
+// written by RT thread only
+static inline monitor_cv_t *
+_monitor_shm_cv(monitor_shm_t *shm, uint32_t nsinks, uint32_t sink)
+{
+	return &_monitor_shm_sink(shm, nsinks, sink)->cv;
+}
+
+static inline atomic_int *
+_monitor_shm_slots(monitor_shm_t *shm, uint32_t sink)
+{
+	return &shm->jgains[sink*MONITOR_SLOTS];
+}
+
+// held peaks are float bit patterns, which order like integers for positive floats
+static inline int32_t
+_monitor_peak_to_held(float peak)
+{
+	int32_t held;
+	memcpy(&held, &peak, sizeof(held));
+
+	return held;
+}
+
+static inline float
+_monitor_held_to_peak(int32_t held)
+{
+	float peak;
+	memcpy(&peak, &held, sizeof(peak));
+
+	return peak;
+}
+
+// raise held value until UI takes it
+static inline void
+_monitor_hold(atomic_int *jgain, int32_t held)
+{
+	int32_t old = atomic_load_explicit(jgain, memory_order_relaxed);
+
+	// fails at most once per UI frame, when UI has taken value in between
+	while( (held > old) && !atomic_compare_exchange_weak_explicit(jgain, &old, held,
+		memory_order_relaxed, memory_order_relaxed) )
+	{
+		// old has been updated
+	}
+}
+
+// extremes and sum of squares of a group of sinks, accumulated by scan kernels
+struct _monitor_stats_t {
+	float min [MONITOR_LANES];
+	float max [MONITOR_LANES];
+	float sum [MONITOR_LANES];
+};
+
+// running extremes and sum of squares of each sink of a group
+static inline void
+_audio_monitor_scan_sink(const float *psink, jack_nframes_t nframes,
+	float *min, float *max, float *sum)
+{
+	float mn = *min;
+	float mx = *max;
+	float s = 0.f;
+
+	for(unsigned k = 0; k < nframes; k++)
+	{
+		const float x = psink[k];
+
+		if(x < mn)
+			mn = x;
+		if(x > mx)
+			mx = x;
+		s += x * x;
+	}
+
+	*min = mn;
+	*max = mx;
+	*sum += s;
+}
+
+static inline void
+_audio_monitor_scan_c(const float *const *psinks, jack_nframes_t nframes,
+	monitor_stats_t *stats)
+{
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		_audio_monitor_scan_sink(psinks[l], nframes,
+			&stats->min[l], &stats->max[l], &stats->sum[l]);
+	}
+}
+
+#if defined(MONITOR_SSE)
+// one sink's remaining frames into running vectors
+static inline void
+_audio_monitor_scan_tail_sse(__m128 *mn, __m128 *mx, __m128 *s,
+	const float *psink, unsigned k, jack_nframes_t nframes)
+{
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const __m128 x = _mm_loadu_ps(&psink[k]);
+
+		*mn = _mm_min_ps(x, *mn);
+		*mx = _mm_max_ps(x, *mx);
+		*s = _mm_add_ps(_mm_mul_ps(x, x), *s);
+	}
+
+	for( ; k < nframes; k++) // upper lanes are taken from first operand
+	{
+		const __m128 x = _mm_load_ss(&psink[k]);
+
+		*mn = _mm_min_ss(*mn, x);
+		*mx = _mm_max_ss(*mx, x);
+		*s = _mm_add_ss(*s, _mm_mul_ss(x, x));
+	}
+}
+
+// horizontal reductions of each sink's vectors, all four sinks in one go
+static inline void
+_audio_monitor_scan_reduce_sse(__m128 mn [MONITOR_LANES], __m128 mx [MONITOR_LANES],
+	__m128 s [MONITOR_LANES], monitor_stats_t *stats)
+{
+	_MM_TRANSPOSE4_PS(mn[0], mn[1], mn[2], mn[3]);
+	_MM_TRANSPOSE4_PS(mx[0], mx[1], mx[2], mx[3]);
+	_MM_TRANSPOSE4_PS(s[0], s[1], s[2], s[3]);
+
+	_mm_storeu_ps(stats->min, _mm_min_ps(_mm_min_ps(mn[0], mn[1]), _mm_min_ps(mn[2], mn[3])));
+	_mm_storeu_ps(stats->max, _mm_max_ps(_mm_max_ps(mx[0], mx[1]), _mm_max_ps(mx[2], mx[3])));
+	_mm_storeu_ps(stats->sum, _mm_add_ps(_mm_add_ps(s[0], s[1]), _mm_add_ps(s[2], s[3])));
+}
+
+static inline void
+_audio_monitor_scan_sse(const float *const *psinks, jack_nframes_t nframes,
+	monitor_stats_t *stats)
+{
+	const float *p0 = psinks[0];
+	const float *p1 = psinks[1];
+	const float *p2 = psinks[2];
+	const float *p3 = psinks[3];
+	__m128 mn [MONITOR_LANES];
+	__m128 mx [MONITOR_LANES];
+	__m128 s [MONITOR_LANES];
+	unsigned k = 0;
+
+	// running values enter the reductions once
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		mn[l] = _mm_set1_ps(stats->min[l]);
+		mx[l] = _mm_set1_ps(stats->max[l]);
+		s[l] = _mm_set_ss(stats->sum[l]);
+	}
+
+	// interleave sinks, so that there are independent chains per sink
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const __m128 x0 = _mm_loadu_ps(&p0[k]);
+		const __m128 x1 = _mm_loadu_ps(&p1[k]);
+		const __m128 x2 = _mm_loadu_ps(&p2[k]);
+		const __m128 x3 = _mm_loadu_ps(&p3[k]);
+
+		mn[0] = _mm_min_ps(x0, mn[0]);
+		mn[1] = _mm_min_ps(x1, mn[1]);
+		mn[2] = _mm_min_ps(x2, mn[2]);
+		mn[3] = _mm_min_ps(x3, mn[3]);
+		mx[0] = _mm_max_ps(x0, mx[0]);
+		mx[1] = _mm_max_ps(x1, mx[1]);
+		mx[2] = _mm_max_ps(x2, mx[2]);
+		mx[3] = _mm_max_ps(x3, mx[3]);
+		s[0] = _mm_add_ps(_mm_mul_ps(x0, x0), s[0]);
+		s[1] = _mm_add_ps(_mm_mul_ps(x1, x1), s[1]);
+		s[2] = _mm_add_ps(_mm_mul_ps(x2, x2), s[2]);
+		s[3] = _mm_add_ps(_mm_mul_ps(x3, x3), s[3]);
+	}
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+		_audio_monitor_scan_tail_sse(&mn[l], &mx[l], &s[l], psinks[l], k, nframes);
+
+	_audio_monitor_scan_reduce_sse(mn, mx, s, stats);
+}
+#endif
+
+#if defined(MONITOR_AVX)
+__attribute__((target("avx")))
+static inline __m128
+_audio_monitor_fold_max_avx(__m256 m)
+{
+	return _mm_max_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1));
+}
+
+__attribute__((target("avx")))
+static inline void
+_audio_monitor_scan_avx(const float *const *psinks, jack_nframes_t nframes,
+	monitor_stats_t *stats)
+{
+	const float *p0 = psinks[0];
+	const float *p1 = psinks[1];
+	const float *p2 = psinks[2];
+	const float *p3 = psinks[3];
+	__m256 mn [MONITOR_LANES];
+	__m256 mx [MONITOR_LANES];
+	__m256 s [MONITOR_LANES];
+	__m128 mn4 [MONITOR_LANES];
+	__m128 mx4 [MONITOR_LANES];
+	__m128 s4 [MONITOR_LANES];
+	unsigned k = 0;
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		mn[l] = _mm256_set1_ps(stats->min[l]);
+		mx[l] = _mm256_set1_ps(stats->max[l]);
+		s[l] = _mm256_setr_ps(stats->sum[l], 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f);
+	}
+
+	for( ; k + 8 <= nframes; k += 8)
+	{
+		const __m256 x0 = _mm256_loadu_ps(&p0[k]);
+		const __m256 x1 = _mm256_loadu_ps(&p1[k]);
+		const __m256 x2 = _mm256_loadu_ps(&p2[k]);
+		const __m256 x3 = _mm256_loadu_ps(&p3[k]);
+
+		mn[0] = _mm256_min_ps(x0, mn[0]);
+		mn[1] = _mm256_min_ps(x1, mn[1]);
+		mn[2] = _mm256_min_ps(x2, mn[2]);
+		mn[3] = _mm256_min_ps(x3, mn[3]);
+		mx[0] = _mm256_max_ps(x0, mx[0]);
+		mx[1] = _mm256_max_ps(x1, mx[1]);
+		mx[2] = _mm256_max_ps(x2, mx[2]);
+		mx[3] = _mm256_max_ps(x3, mx[3]);
+		s[0] = _mm256_add_ps(_mm256_mul_ps(x0, x0), s[0]);
+		s[1] = _mm256_add_ps(_mm256_mul_ps(x1, x1), s[1]);
+		s[2] = _mm256_add_ps(_mm256_mul_ps(x2, x2), s[2]);
+		s[3] = _mm256_add_ps(_mm256_mul_ps(x3, x3), s[3]);
+	}
+
+	// fold halves, remaining frames go through SSE tails
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		mn4[l] = _mm_min_ps(_mm256_castps256_ps128(mn[l]), _mm256_extractf128_ps(mn[l], 1));
+		mx4[l] = _audio_monitor_fold_max_avx(mx[l]);
+		s4[l] = _mm_add_ps(_mm256_castps256_ps128(s[l]), _mm256_extractf128_ps(s[l], 1));
+
+		_audio_monitor_scan_tail_sse(&mn4[l], &mx4[l], &s4[l], psinks[l], k, nframes);
+	}
+
+	_audio_monitor_scan_reduce_sse(mn4, mx4, s4, stats);
+}
+#endif
+
+#if defined(MONITOR_NEON)
+static inline void
+_audio_monitor_scan_tail_neon(float32x4_t *mn, float32x4_t *mx, float *s,
+	const float *psink, unsigned k, jack_nframes_t nframes)
+{
+	float32x4_t s4 = vdupq_n_f32(0.f);
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const float32x4_t x = vld1q_f32(&psink[k]);
+
+		*mn = vminq_f32(x, *mn);
+		*mx = vmaxq_f32(x, *mx);
+		s4 = vmlaq_f32(s4, x, x);
+	}
+
+	*s += vaddvq_f32(s4);
+
+	for( ; k < nframes; k++) // duplicates leave other lanes' extremes as they are
+	{
+		const float32x4_t x = vld1q_dup_f32(&psink[k]);
+
+		*mn = vminq_f32(x, *mn);
+		*mx = vmaxq_f32(x, *mx);
+		*s += psink[k] * psink[k];
+	}
+}
+
+static inline void
+_audio_monitor_scan_neon(const float *const *psinks, jack_nframes_t nframes,
+	monitor_stats_t *stats)
+{
+	const float *p0 = psinks[0];
+	const float *p1 = psinks[1];
+	const float *p2 = psinks[2];
+	const float *p3 = psinks[3];
+	float32x4_t mn [MONITOR_LANES];
+	float32x4_t mx [MONITOR_LANES];
+	float32x4_t s [MONITOR_LANES];
+	float tails [MONITOR_LANES] = { 0.f };
+	unsigned k = 0;
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		mn[l] = vdupq_n_f32(stats->min[l]);
+		mx[l] = vdupq_n_f32(stats->max[l]);
+		s[l] = vdupq_n_f32(0.f);
+	}
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const float32x4_t x0 = vld1q_f32(&p0[k]);
+		const float32x4_t x1 = vld1q_f32(&p1[k]);
+		const float32x4_t x2 = vld1q_f32(&p2[k]);
+		const float32x4_t x3 = vld1q_f32(&p3[k]);
+
+		mn[0] = vminq_f32(x0, mn[0]);
+		mn[1] = vminq_f32(x1, mn[1]);
+		mn[2] = vminq_f32(x2, mn[2]);
+		mn[3] = vminq_f32(x3, mn[3]);
+		mx[0] = vmaxq_f32(x0, mx[0]);
+		mx[1] = vmaxq_f32(x1, mx[1]);
+		mx[2] = vmaxq_f32(x2, mx[2]);
+		mx[3] = vmaxq_f32(x3, mx[3]);
+		s[0] = vmlaq_f32(s[0], x0, x0);
+		s[1] = vmlaq_f32(s[1], x1, x1);
+		s[2] = vmlaq_f32(s[2], x2, x2);
+		s[3] = vmlaq_f32(s[3], x3, x3);
+	}
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+		_audio_monitor_scan_tail_neon(&mn[l], &mx[l], &tails[l], psinks[l], k, nframes);
+
+	// pairwise reductions handle all four sinks at once
+	vst1q_f32(stats->min, vpminq_f32(vpminq_f32(mn[0], mn[1]), vpminq_f32(mn[2], mn[3])));
+	vst1q_f32(stats->max, vpmaxq_f32(vpmaxq_f32(mx[0], mx[1]), vpmaxq_f32(mx[2], mx[3])));
+	vst1q_f32(stats->sum, vaddq_f32(vaddq_f32(vld1q_f32(stats->sum), vld1q_f32(tails)),
+		vpaddq_f32(vpaddq_f32(s[0], s[1]), vpaddq_f32(s[2], s[3]))));
+}
+#endif
+
+static inline monitor_scan_t
+_audio_monitor_scan_select(void)
+{
+#if defined(MONITOR_AVX)
+	if(__builtin_cpu_supports("avx"))
+		return _audio_monitor_scan_avx;
+#endif
+#if defined(MONITOR_SSE)
+	return _audio_monitor_scan_sse;
+#elif defined(MONITOR_NEON)
+	return _audio_monitor_scan_neon;
+#else
+	return _audio_monitor_scan_c;
+#endif
+}
+
+static inline float
+_audio_monitor_stats_peak(const monitor_stats_t *stats, unsigned l)
+{
+	return stats->max[l] > -stats->min[l] ? stats->max[l] : -stats->min[l];
+}
+
+static void
+_shm_header_init(shm_header_t *header, size_t size, port_type_t type,
+	uint32_t nsinks, uint32_t nsources)
+{
+	header->size = size;
+	header->type = type;
+	header->nsinks = nsinks;
+	header->nsources = nsources;
+	header->version = SHM_VERSION;
+}
+
+static atomic_int *
+_mixer_shm_bank(mixer_shm_t *shm, uint32_t bank)
+{
+	return &shm->jgains[bank*shm->header.nsources*shm->header.nsinks];
+}
+
+static atomic_int *
+_mixer_shm_live(mixer_shm_t *shm)
+{
+	return _mixer_shm_bank(shm, atomic_load_explicit(&shm->bank, memory_order_acquire));
+}
+
+static atomic_int *
+_mixer_shm_scene(mixer_shm_t *shm, uint32_t slot)
+{
+	return _mixer_shm_bank(shm, 2 + slot);
+}
+
+static atomic_int *
+_mixer_shm_gain(mixer_shm_t *shm, uint32_t nsource, uint32_t nsink)
+{
+	return &_mixer_shm_live(shm)[nsource*shm->header.nsinks + nsink];
+}
+
+// held peaks of sinks, then of sources, right after last bank, taken by UI
+static atomic_int *
+_mixer_shm_peaks(mixer_shm_t *shm)
+{
+	return _mixer_shm_bank(shm, MIXER_BANKS);
+}
+
+static void
+_shm_resize_request(atomic_uint *resize, sem_t *done,
+	uint32_t nsinks, uint32_t nsources)
+{
+	if( (nsinks < 1) || (nsinks > PORT_MAX) || (nsources > PORT_MAX) )
+		return;
+
+	atomic_store_explicit(resize, (nsinks << 16) | nsources, memory_order_release);
+	sem_post(done); // wake main thread of mixer or monitor
+}
+
+static void
+_monitor_repair_request(monitor_shm_t *shm)
+{
+	atomic_store_explicit(&shm->repair, true, memory_order_release);
+	sem_post(&shm->done); // wake main thread of monitor
+}
+
+static void
+_mixer_scene_request(mixer_shm_t *shm, uint32_t slot, bool store, uint32_t fade)
+{
+	if(slot >= MIXER_SCENE_MAX)
+		return;
+
+	if(fade > MIXER_FADE_MAX)
+		fade = MIXER_FADE_MAX;
+
+	atomic_store_explicit(&shm->scene,
+		(fade << 16) | (store ? MIXER_SCENE_STORE : 0) | (slot + 1), memory_order_release);
+	sem_post(&shm->done); // wake main thread of mixer
+}
+
+static int
+_host_request(host_shm_t *shm, host_kind_t kind, port_type_t type,
+	uint32_t nsinks, uint32_t nsources, bool metered)
+{
+	if( (nsinks < 1) || (nsinks > PORT_MAX) || (nsources > PORT_MAX) )
+		return -1;
+
+	for(unsigned r = 0; r < HOST_REQUEST_MAX; r++)
+	{
+		host_request_t *req = &shm->requests[r];
+		unsigned expected = HOST_SLOT_FREE;
+
+		if(!atomic_compare_exchange_strong_explicit(&req->slot, &expected, HOST_SLOT_BUSY,
+				memory_order_acquire, memory_order_relaxed))
+			continue;
+
+		req->kind = kind;
+		req->type = type;
+		req->nsinks = nsinks;
+		req->nsources = nsources;
+		req->metered = metered;
+
+		atomic_store_explicit(&req->slot, HOST_SLOT_READY, memory_order_release);
+		sem_post(&shm->done); // wake main thread of host
+
+		return 0;
+	}
+
+	return -1; // host is backlogged
+}
+
+// hosted instances share a JACK client, their ports are prefixed by group
+static jack_port_t *
+_group_port_register(jack_client_t *client, const char *group,
+	const char *short_name, const char *port_type, unsigned long flags)
+{
+	char buf [NAME_MAX_LEN + 32];
+	if(group)
+		snprintf(buf, sizeof(buf), "%s:%s", group, short_name);
+	else
+		snprintf(buf, sizeof(buf), "%s", short_name);
+
+	jack_port_t *port = jack_port_register(client, buf, port_type, flags, 0);
+
+#ifdef JACK_HAS_METADATA_API
+	if(port && group)
+	{
+		jack_set_property(client, jack_port_uuid(port), JACK_METADATA_PORT_GROUP,
+			group, "text/plain");
+	}
+#endif
+
+	return port;
+}
+
+static int
+_shm_sync(atomic_int *sync, atomic_bool *closing, sync_state_t state,
+	sync_state_t ack, unsigned timeout)
+{
+	atomic_store_explicit(sync, state, memory_order_release);
+
+	// wait for RT thread to pick it up at its next cycle boundary
+	for(unsigned ms = 0; !timeout || (ms < timeout); ms++)
+	{
+		if(atomic_load_explicit(sync, memory_order_acquire) == (int)ack)
+			return 0;
+
+		if(atomic_load_explicit(closing, memory_order_relaxed))
+			break;
+
+		usleep(1000);
+	}
+
+	return -1;
+}
+
 static const char *port_labels [] = {
 	[TYPE_NONE] = NULL,
 	[TYPE_AUDIO] = "AUDIO",
@@ -506,6 +1330,27 @@ _port_type_to_string(port_type_t port_type)
 	return port_labels[port_type];
 }
 
+static const char *monitor_mode_labels [MONITOR_MAX] = {
+	[MONITOR_PEAK] = "peak",
+	[MONITOR_RMS] = "rms",
+	[MONITOR_LUFS] = "lufs",
+	[MONITOR_TRUE_PEAK] = "true-peak",
+	[MONITOR_SPECTRUM] = "spectrum",
+	[MONITOR_CORRELATION] = "correlation"
+};
+
+static monitor_mode_t
+_monitor_mode_from_string(const char *str)
+{
+	for(monitor_mode_t mode = MONITOR_PEAK; mode < MONITOR_MAX; mode++)
+	{
+		if(!strcasecmp(str, monitor_mode_labels[mode]))
+			return mode;
+	}
+
+	return MONITOR_MAX;
+}
+
 static const char *designations [DESIGNATION_MAX] = {
 	[DESIGNATION_NONE] = NULL,
 	[DESIGNATION_LEFT] = LV2_PORT_GROUPS__left,
@@ -0,0 +1,1079 @@
+/*
+ * Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the iapplied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <time.h>
+
+#include <patchmatrix_mixer.h>
+#include <patchmatrix_monitor.h>
+
+#include <osc.lv2/writer.h>
+
+#define BENCH_FRAMES_MAX 4096
+#define BENCH_EVENTS_MAX 0x1000 // fits one OSC message per cell of largest matrix
+#define BENCH_DATA_MAX 0x4000
+#define BENCH_WORK 0x4000000 // frames x cells to process per measurement
+#define BENCH_REPEAT 5 // best of measurements is reported
+#define BENCH_OSC_MAX 0x100000 // bytes of OSC packets per matrix update
+#define BENCH_OSC_DIM_MAX 64
+#define BENCH_MIDI_DIM_MAX 128
+#define BENCH_MIDI_EVENTS_MAX 64 // per sink and cycle
+
+typedef struct _bench_midi_t bench_midi_t;
+
+struct _bench_midi_t {
+	uint32_t count;
+	size_t used;
+	jack_midi_event_t events [BENCH_EVENTS_MAX];
+	uint8_t data [BENCH_DATA_MAX];
+};
+
+// stand-ins for the JACK port API, so the process kernels run without a server
+struct _jack_port {
+	void *buf;
+};
+
+void *
+jack_port_get_buffer(jack_port_t *port, jack_nframes_t nframes)
+{
+	return port->buf;
+}
+
+uint32_t
+jack_midi_get_event_count(void *port_buffer)
+{
+	bench_midi_t *midi = port_buffer;
+
+	return midi->count;
+}
+
+int
+jack_midi_event_get(jack_midi_event_t *event, void *port_buffer, uint32_t event_index)
+{
+	bench_midi_t *midi = port_buffer;
+
+	if(event_index >= midi->count)
+		return -ENOBUFS;
+
+	*event = midi->events[event_index];
+
+	return 0;
+}
+
+void
+jack_midi_clear_buffer(void *port_buffer)
+{
+	bench_midi_t *midi = port_buffer;
+
+	midi->count = 0;
+	midi->used = 0;
+}
+
+jack_midi_data_t *
+jack_midi_event_reserve(void *port_buffer, jack_nframes_t time, size_t data_size)
+{
+	bench_midi_t *midi = port_buffer;
+
+	if( (midi->count >= BENCH_EVENTS_MAX) || (midi->used + data_size > BENCH_DATA_MAX) )
+		return NULL;
+
+	jack_midi_event_t *ev = &midi->events[midi->count++];
+	ev->time = time;
+	ev->size = data_size;
+	ev->buffer = &midi->data[midi->used];
+	midi->used += data_size;
+
+	return ev->buffer;
+}
+
+int
+jack_get_cycle_times(const jack_client_t *client, jack_nframes_t *current_frames,
+	jack_time_t *current_usecs, jack_time_t *next_usecs, float *period_usecs)
+{
+	return -1; // no timetag scheduling without a server
+}
+
+jack_nframes_t
+jack_last_frame_time(const jack_client_t *client)
+{
+	return 0;
+}
+
+jack_time_t
+jack_get_time(void)
+{
+	return 0;
+}
+
+int
+jack_is_realtime(jack_client_t *client)
+{
+	return 0;
+}
+
+int
+jack_client_real_time_priority(jack_client_t *client)
+{
+	return 0;
+}
+
+int
+jack_client_create_thread(jack_client_t *client, jack_native_thread_t *thread,
+	int priority, int realtime, void *(*start_routine)(void *), void *arg)
+{
+	return pthread_create(thread, NULL, start_routine, arg);
+}
+
+int
+jack_client_stop_thread(jack_client_t *client, jack_native_thread_t thread)
+{
+	return pthread_join(thread, NULL);
+}
+
+static double
+_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static void
+_bench_midi_spread(bench_midi_t *midi, unsigned nevents, jack_nframes_t nframes)
+{
+	// spread events evenly across cycle
+	for(unsigned e = 0; e < midi->count; e++)
+	{
+		midi->events[e].time = (uint64_t)e * nframes / nevents;
+	}
+}
+
+static void
+_bench_autom_write(bench_midi_t *autom, unsigned nevents, jack_nframes_t nframes,
+	unsigned nsinks, unsigned nsources, float mBFS)
+{
+	jack_midi_clear_buffer(autom);
+
+	// one cell message per event, walking across the matrix
+	for(unsigned e = 0; e < nevents; e++)
+	{
+		LV2_OSC_Writer writer;
+		size_t size;
+
+		lv2_osc_writer_initialize(&writer, &autom->data[autom->used],
+			BENCH_DATA_MAX - autom->used);
+		lv2_osc_writer_message_vararg(&writer, "/patchmatrix/mixer", "iif",
+			e % nsinks, (e / nsinks) % nsources, mBFS);
+		if(!lv2_osc_writer_finalize(&writer, &size))
+			exit(-1);
+
+		autom->events[autom->count].size = size;
+		autom->events[autom->count].buffer = &autom->data[autom->used];
+		autom->count++;
+		autom->used += size;
+	}
+
+	_bench_midi_spread(autom, nevents, nframes);
+}
+
+static double
+_bench_audio_mixer(unsigned nsinks, unsigned nsources, jack_nframes_t nframes,
+	jack_nframes_t tile, unsigned nthreads, unsigned nautom, bool metered)
+{
+	static mixer_app_t mixer;
+	static jack_port_t jautom;
+	static bench_midi_t autom [2];
+
+	const size_t shm_size = _mixer_shm_size(nsinks, nsources);
+	mixer_shm_t *shm = aligned_alloc(SHM_CACHE_LINE,
+		(shm_size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1));
+	jack_port_t *jsinks = calloc(nsinks, sizeof(jack_port_t));
+	jack_port_t *jsources = calloc(nsources, sizeof(jack_port_t));
+	float *sinks = calloc(nsinks*BENCH_FRAMES_MAX, sizeof(float));
+	float *sources = calloc(nsources*BENCH_FRAMES_MAX, sizeof(float));
+
+	memset(&mixer, 0x0, sizeof(mixer));
+	mixer.type = TYPE_AUDIO;
+	mixer.tile = tile;
+	mixer.metered = metered;
+	mixer.shm = shm;
+
+	if(_mixer_app_alloc(&mixer, nsinks, nsources) == -1)
+		exit(-1);
+
+	_shm_header_init(&shm->header, shm_size, TYPE_AUDIO, nsinks, nsources);
+	atomic_init(&shm->closing, false);
+	atomic_init(&shm->bank, 0);
+	atomic_init(&shm->flip, 0);
+	shm->metered = metered;
+
+	for(unsigned k = 0; k < nsinks + nsources; k++)
+	{
+		atomic_init(&_mixer_shm_peaks(shm)[k], 0);
+	}
+
+	// alternate between two gains, so that every event starts a ramp
+	_bench_autom_write(&autom[0], nautom, nframes, nsinks, nsources, -1200.f);
+	_bench_autom_write(&autom[1], nautom, nframes, nsinks, nsources, -600.f);
+
+	jautom.buf = &autom[0];
+	mixer.jautom = &jautom;
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		float *sink = &sinks[i*BENCH_FRAMES_MAX];
+
+		for(unsigned k = 0; k < nframes; k++)
+		{
+			sink[k] = (float)rand() / RAND_MAX - 0.5f;
+		}
+
+		jsinks[i].buf = sink;
+		mixer.jsinks[i] = &jsinks[i];
+	}
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		jsources[j].buf = &sources[j*BENCH_FRAMES_MAX];
+		mixer.jsources[j] = &jsources[j];
+
+		// every cell is mixed with a non-unity gain
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			mixer_cell_t *cell = _mixer_cell(&mixer, j, i);
+
+			cell->mBFS = -600;
+			cell->gain = _gain_from_mBFS(cell->mBFS);
+			cell->target = cell->gain;
+			cell->final = cell->gain;
+
+			atomic_init(_mixer_shm_gain(shm, j, i), cell->mBFS);
+		}
+	}
+
+	const unsigned cells = nsinks * nsources;
+	const unsigned cycles = BENCH_WORK / (nframes * cells) + 1;
+
+	double best = HUGE_VAL;
+
+	_audio_mixer_workers_start(&mixer, nthreads);
+
+	_audio_mixer_process(nframes, &mixer); // warm up caches
+
+	for(unsigned r = 0; r < BENCH_REPEAT; r++)
+	{
+		const double t0 = _now();
+		for(unsigned c = 0; c < cycles; c++)
+		{
+			jautom.buf = &autom[c & 1];
+			_audio_mixer_process(nframes, &mixer);
+		}
+		const double t1 = _now();
+
+		if(t1 - t0 < best)
+			best = t1 - t0;
+	}
+
+	_audio_mixer_workers_stop(&mixer);
+
+	_mixer_app_free(&mixer);
+	free(sources);
+	free(sinks);
+	free(jsources);
+	free(jsinks);
+	free(shm);
+
+	return best / ((double)cycles * nframes * cells);
+}
+
+static void
+_bench_notes_write(bench_midi_t *midi, unsigned nevents, jack_nframes_t nframes)
+{
+	jack_midi_clear_buffer(midi);
+
+	// alternating noteOn and noteOff, as velocity is scaled for both
+	for(unsigned e = 0; e < nevents; e++)
+	{
+		uint8_t *msg = jack_midi_event_reserve(midi, 0, 3);
+		if(!msg)
+			exit(-1);
+
+		msg[0] = (e & 1) ? 0x80 : 0x90;
+		msg[1] = 0x3c + (e >> 1) % 0x20;
+		msg[2] = 0x7f - e % 0x40;
+	}
+
+	_bench_midi_spread(midi, nevents, nframes);
+}
+
+static double
+_bench_midi_mixer(unsigned n, jack_nframes_t nframes, unsigned nevents,
+	double *per_event)
+{
+	static mixer_app_t mixer;
+	static jack_port_t jautom;
+	static bench_midi_t autom;
+
+	const size_t shm_size = _mixer_shm_size(n, n);
+	mixer_shm_t *shm = aligned_alloc(SHM_CACHE_LINE,
+		(shm_size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1));
+	jack_port_t *jsinks = calloc(n, sizeof(jack_port_t));
+	jack_port_t *jsources = calloc(n, sizeof(jack_port_t));
+	bench_midi_t *sinks = calloc(n, sizeof(bench_midi_t));
+	bench_midi_t *sources = calloc(n, sizeof(bench_midi_t));
+
+	memset(&mixer, 0x0, sizeof(mixer));
+	mixer.type = TYPE_MIDI;
+	mixer.shm = shm;
+
+	if(_mixer_app_alloc(&mixer, n, n) == -1)
+		exit(-1);
+
+	_shm_header_init(&shm->header, shm_size, TYPE_MIDI, n, n);
+	atomic_init(&shm->closing, false);
+	atomic_init(&shm->bank, 0);
+	atomic_init(&shm->flip, 0);
+
+	jautom.buf = &autom;
+	mixer.jautom = &jautom;
+	jack_midi_clear_buffer(&autom);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		_bench_notes_write(&sinks[i], nevents, nframes);
+
+		jsinks[i].buf = &sinks[i];
+		mixer.jsinks[i] = &jsinks[i];
+	}
+
+	// every sink is routed to every source with a non-unity gain
+	for(unsigned j = 0; j < n; j++)
+	{
+		jsources[j].buf = &sources[j];
+		mixer.jsources[j] = &jsources[j];
+
+		for(unsigned i = 0; i < n; i++)
+		{
+			atomic_init(_mixer_shm_gain(shm, j, i), -600);
+		}
+	}
+
+	_mixer_cells_init(&mixer);
+
+	// routing an event costs about as much as mixing a few audio frames
+	const unsigned cells = n * n;
+	const unsigned cycles = BENCH_WORK / ((nframes + 16*nevents) * cells) + 1;
+
+	double best = HUGE_VAL;
+
+	_midi_mixer_process(nframes, &mixer); // warm up caches
+
+	for(unsigned r = 0; r < BENCH_REPEAT; r++)
+	{
+		const double t0 = _now();
+		for(unsigned c = 0; c < cycles; c++)
+		{
+			_midi_mixer_process(nframes, &mixer);
+		}
+		const double t1 = _now();
+
+		if(t1 - t0 < best)
+			best = t1 - t0;
+	}
+
+	// events written to all sources per cycle
+	*per_event = best / ((double)cycles * nevents * cells);
+
+	_mixer_app_free(&mixer);
+	free(sources);
+	free(sinks);
+	free(jsources);
+	free(jsinks);
+	free(shm);
+
+	return best / ((double)cycles * nframes * cells);
+}
+
+static double
+_bench_monitor(port_type_t type, monitor_mode_t mode, unsigned nsinks,
+	jack_nframes_t nframes, unsigned nevents)
+{
+	static monitor_app_t monitor;
+
+	const size_t shm_size = _monitor_shm_size(nsinks);
+	monitor_shm_t *shm = aligned_alloc(SHM_CACHE_LINE,
+		(shm_size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1));
+	jack_port_t *jsinks = calloc(nsinks, sizeof(jack_port_t));
+	float *audio = NULL;
+	bench_midi_t *midi = NULL;
+
+	memset(&monitor, 0x0, sizeof(monitor));
+	monitor.type = type;
+	monitor.mode = mode;
+	monitor.shm = shm;
+	_monitor_sample_rate_init(&monitor, 48000);
+
+	if(_monitor_app_alloc(&monitor, nsinks) == -1)
+		exit(-1);
+
+	_shm_header_init(&shm->header, shm_size, type, nsinks, 0);
+	atomic_init(&shm->closing, false);
+
+	// worker runs alongside, only handing over cycles counts for RT thread
+	if( (mode == MONITOR_SPECTRUM) && (_monitor_spectrum_start(&monitor, 48000) == -1) )
+		exit(-1);
+
+	// adjacent pairs, as found for undesignated sinks
+	if(mode == MONITOR_CORRELATION)
+	{
+		for(unsigned p = 0; p < nsinks/2; p++)
+			monitor.corrs[p] = (monitor_corr_t){ .left = 2*p, .right = 2*p + 1 };
+
+		monitor.ncorrs = nsinks/2;
+	}
+
+#ifdef JACK_HAS_METADATA_API
+	const bool is_osc = (type == TYPE_OSC);
+#else
+	const bool is_osc = false;
+#endif
+
+	if( (type == TYPE_MIDI) || is_osc )
+	{
+		midi = calloc(nsinks, sizeof(bench_midi_t));
+
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			if(is_osc)
+				_bench_autom_write(&midi[i], nevents, nframes, 1, 1, 0.f);
+			else
+				_bench_notes_write(&midi[i], nevents, nframes);
+			jsinks[i].buf = &midi[i];
+		}
+	}
+	else
+	{
+		audio = calloc(nsinks*BENCH_FRAMES_MAX, sizeof(float));
+
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			float *sink = &audio[i*BENCH_FRAMES_MAX];
+
+			for(unsigned k = 0; k < nframes; k++)
+			{
+				sink[k] = (float)rand() / RAND_MAX - 0.5f;
+			}
+
+			jsinks[i].buf = sink;
+		}
+	}
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		monitor.jsinks[i] = &jsinks[i];
+	}
+
+	int (*process)(jack_nframes_t nframes, void *arg) = _monitor_process_callback(type);
+	const unsigned cycles = BENCH_WORK / (nframes * nsinks) + 1;
+
+	double best = HUGE_VAL;
+
+	process(nframes, &monitor); // warm up caches
+
+	for(unsigned r = 0; r < BENCH_REPEAT; r++)
+	{
+		const double t0 = _now();
+		for(unsigned c = 0; c < cycles; c++)
+		{
+			process(nframes, &monitor);
+		}
+		const double t1 = _now();
+
+		if(t1 - t0 < best)
+			best = t1 - t0;
+	}
+
+	_monitor_spectrum_stop(&monitor);
+	_monitor_app_free(&monitor);
+	free(midi);
+	free(audio);
+	free(jsinks);
+	free(shm);
+
+	return best / ((double)cycles * nframes * nsinks);
+}
+
+#ifdef JACK_HAS_METADATA_API
+// offset CV never crosses zero, so history and blocks must agree on its extremes
+static bool
+_bench_cv_check(void)
+{
+	static monitor_app_t monitor;
+	static const float lo [] = {5.f, 0.25f, -3.f, 1.f};
+	static const float hi [] = {5.f, 0.25f, -3.f, 2.f}; // alternating
+	const unsigned nsinks = sizeof(lo)/sizeof(lo[0]);
+	const jack_nframes_t nframes = 1024;
+
+	const size_t shm_size = _monitor_shm_size(nsinks);
+	monitor_shm_t *shm = aligned_alloc(SHM_CACHE_LINE,
+		(shm_size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1));
+	jack_port_t *jsinks = calloc(nsinks, sizeof(jack_port_t));
+	float *audio = calloc(nsinks*nframes, sizeof(float));
+	bool passed = true;
+
+	memset(shm, 0x0, shm_size);
+	memset(&monitor, 0x0, sizeof(monitor));
+	monitor.type = TYPE_CV;
+	monitor.mode = MONITOR_PEAK;
+	monitor.shm = shm;
+	_monitor_sample_rate_init(&monitor, 48000);
+
+	if(_monitor_app_alloc(&monitor, nsinks) == -1)
+		exit(-1);
+
+	_shm_header_init(&shm->header, shm_size, TYPE_CV, nsinks, 0);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		float *sink = &audio[i*nframes];
+
+		for(unsigned k = 0; k < nframes; k++)
+		{
+			sink[k] = (k & 1) ? hi[i] : lo[i];
+		}
+
+		jsinks[i].buf = sink;
+		monitor.jsinks[i] = &jsinks[i];
+	}
+
+	// a few blocks worth of cycles
+	for(unsigned c = 0; c < 4*monitor.block/nframes + 1; c++)
+	{
+		_cv_monitor_process(nframes, &monitor);
+	}
+
+	const uint32_t head = atomic_load_explicit(&shm->history, memory_order_acquire);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		const monitor_cv_t *cv = _monitor_shm_cv(shm, nsinks, i);
+		const uint32_t blocks = atomic_load_explicit(&cv->blocks, memory_order_acquire);
+		const monitor_block_t *block = &cv->ring[(blocks - 1) % MONITOR_CV_BLOCKS];
+
+		for(uint32_t e = 0; e < head; e++)
+		{
+			const monitor_history_t *entry = &_monitor_shm_history(shm, nsinks, i)[
+				e % MONITOR_HISTORY];
+
+			if( (entry->min != block->min) || (entry->max != block->max)
+				|| (entry->min != lo[i]) || (entry->max != hi[i]) )
+			{
+				fprintf(stderr, "sink %u entry %"PRIu32": history %f..%f, block %f..%f\n",
+					i, e, entry->min, entry->max, block->min, block->max);
+				passed = false;
+				break;
+			}
+		}
+
+		if(blocks == 0)
+			passed = false;
+	}
+
+	_monitor_app_free(&monitor);
+	free(audio);
+	free(jsinks);
+	free(shm);
+
+	return passed;
+}
+#endif
+
+typedef struct _bench_scan_t bench_scan_t;
+
+struct _bench_scan_t {
+	const char *label;
+	monitor_scan_t scan;
+};
+
+static const bench_scan_t bench_scans [] = {
+	{ .label = "c", .scan = _audio_monitor_scan_c },
+#if defined(MONITOR_SSE)
+	{ .label = "sse", .scan = _audio_monitor_scan_sse },
+#endif
+#if defined(MONITOR_AVX)
+	{ .label = "avx", .scan = _audio_monitor_scan_avx },
+#endif
+#if defined(MONITOR_NEON)
+	{ .label = "neon", .scan = _audio_monitor_scan_neon },
+#endif
+};
+
+static double
+_bench_scan(monitor_scan_t scan, unsigned nsinks, jack_nframes_t nframes)
+{
+	float *audio = calloc(nsinks*BENCH_FRAMES_MAX, sizeof(float));
+	const float **psinks = calloc(nsinks, sizeof(float *));
+	monitor_stats_t *results = calloc(nsinks / MONITOR_LANES, sizeof(monitor_stats_t));
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		float *sink = &audio[i*BENCH_FRAMES_MAX];
+
+		for(unsigned k = 0; k < nframes; k++)
+		{
+			sink[k] = (float)rand() / RAND_MAX - 0.5f;
+		}
+
+		psinks[i] = sink;
+	}
+
+	const unsigned cycles = BENCH_WORK / (nframes * nsinks) + 1;
+
+	double best = HUGE_VAL;
+
+	for(unsigned r = 0; r < BENCH_REPEAT; r++)
+	{
+		const double t0 = _now();
+		for(unsigned c = 0; c < cycles; c++)
+		{
+			for(unsigned i = 0; i < nsinks; i += MONITOR_LANES)
+			{
+				scan(&psinks[i], nframes, &results[i / MONITOR_LANES]);
+			}
+		}
+		const double t1 = _now();
+
+		if(t1 - t0 < best)
+			best = t1 - t0;
+	}
+
+	free(results);
+	free(psinks);
+	free(audio);
+
+	return best / ((double)cycles * nframes * nsinks);
+}
+
+typedef enum _bench_osc_t {
+	BENCH_OSC_CELL,
+	BENCH_OSC_ROW,
+	BENCH_OSC_COLUMN,
+	BENCH_OSC_MATRIX,
+	BENCH_OSC_BLOB
+} bench_osc_t;
+
+static const char *bench_osc_labels [] = {
+	[BENCH_OSC_CELL] = "cell",
+	[BENCH_OSC_ROW] = "row",
+	[BENCH_OSC_COLUMN] = "column",
+	[BENCH_OSC_MATRIX] = "matrix",
+	[BENCH_OSC_BLOB] = "blob"
+};
+
+static void
+_bench_osc_floats(LV2_OSC_Writer *writer, const char *path, int32_t idx,
+	unsigned n, float mBFS)
+{
+	char fmt [BENCH_OSC_DIM_MAX*BENCH_OSC_DIM_MAX + 2];
+	unsigned l = 0;
+
+	if(idx >= 0)
+		fmt[l++] = 'i';
+	for(unsigned k = 0; k < n; k++)
+		fmt[l++] = 'f';
+	fmt[l] = '\0';
+
+	lv2_osc_writer_add_path(writer, path);
+	lv2_osc_writer_add_format(writer, fmt);
+	if(idx >= 0)
+		lv2_osc_writer_add_int32(writer, idx);
+	for(unsigned k = 0; k < n; k++)
+		lv2_osc_writer_add_float(writer, mBFS);
+}
+
+static unsigned
+_bench_osc_write(bench_midi_t *autom, uint8_t *buf, bench_osc_t mode,
+	unsigned nsinks, unsigned nsources, float mBFS)
+{
+	jack_midi_clear_buffer(autom);
+
+	// one event per message, as a controller would send them
+	unsigned nmsgs = 0;
+	size_t used = 0;
+
+	const unsigned count = (mode == BENCH_OSC_CELL) ? nsinks*nsources
+		: (mode == BENCH_OSC_ROW) ? nsources
+		: (mode == BENCH_OSC_COLUMN) ? nsinks
+		: 1;
+
+	for(unsigned m = 0; m < count; m++)
+	{
+		LV2_OSC_Writer writer;
+		lv2_osc_writer_initialize(&writer, &buf[used], BENCH_OSC_MAX - used);
+
+		switch(mode)
+		{
+			case BENCH_OSC_CELL:
+			{
+				lv2_osc_writer_message_vararg(&writer, "/patchmatrix/mixer", "iif",
+					m % nsinks, m / nsinks, mBFS);
+			} break;
+			case BENCH_OSC_ROW:
+			{
+				_bench_osc_floats(&writer, "/patchmatrix/mixer/row", m, nsinks, mBFS);
+			} break;
+			case BENCH_OSC_COLUMN:
+			{
+				_bench_osc_floats(&writer, "/patchmatrix/mixer/column", m, nsources, mBFS);
+			} break;
+			case BENCH_OSC_MATRIX:
+			{
+				_bench_osc_floats(&writer, "/patchmatrix/mixer/matrix", -1, nsinks*nsources, mBFS);
+			} break;
+			case BENCH_OSC_BLOB:
+			{
+				uint8_t *body = NULL;
+
+				lv2_osc_writer_add_path(&writer, "/patchmatrix/mixer/matrix");
+				lv2_osc_writer_add_format(&writer, "b");
+				if(!lv2_osc_writer_add_blob_inline(&writer, nsinks*nsources*sizeof(float), &body))
+					exit(-1);
+
+				for(unsigned k = 0; k < nsinks*nsources; k++)
+				{
+					const union swap32_t s32 = { .f = mBFS };
+					const uint32_t be = htobe32(s32.u);
+
+					memcpy(&body[k*sizeof(float)], &be, sizeof(float));
+				}
+			} break;
+		}
+
+		size_t size;
+		if(!lv2_osc_writer_finalize(&writer, &size))
+			exit(-1);
+
+		autom->events[nmsgs].time = 0;
+		autom->events[nmsgs].size = size;
+		autom->events[nmsgs].buffer = &buf[used];
+		used += size;
+		nmsgs++;
+	}
+
+	autom->count = nmsgs;
+	autom->used = used;
+
+	return used;
+}
+
+static double
+_bench_osc(unsigned n, bench_osc_t mode, size_t *bytes)
+{
+	static mixer_app_t mixer;
+	static bench_midi_t autom [2];
+
+	const size_t shm_size = _mixer_shm_size(n, n);
+	mixer_shm_t *shm = aligned_alloc(SHM_CACHE_LINE,
+		(shm_size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1));
+	uint8_t *bufs = malloc(2*BENCH_OSC_MAX);
+
+	memset(&mixer, 0x0, sizeof(mixer));
+	mixer.type = TYPE_AUDIO;
+	mixer.shm = shm;
+
+	if(_mixer_app_alloc(&mixer, n, n) == -1)
+		exit(-1);
+
+	_shm_header_init(&shm->header, shm_size, TYPE_AUDIO, n, n);
+	atomic_init(&shm->bank, 0);
+
+	// alternate between two gains, so that every message changes every cell
+	*bytes = _bench_osc_write(&autom[0], &bufs[0], mode, n, n, -600.f);
+	_bench_osc_write(&autom[1], &bufs[BENCH_OSC_MAX], mode, n, n, -1200.f);
+
+	const unsigned cells = n * n;
+	const unsigned updates = BENCH_WORK / (64 * cells) + 1;
+
+	double best = HUGE_VAL;
+
+	for(unsigned r = 0; r < BENCH_REPEAT; r++)
+	{
+		const double t0 = _now();
+		for(unsigned u = 0; u < updates; u++)
+		{
+			bench_midi_t *midi = &autom[u & 1];
+
+			for(unsigned p = 0; p < midi->count; p++)
+			{
+				_autom_handle(&mixer, &midi->events[p]);
+			}
+
+			// as at the start of a cycle
+			for(unsigned k = 0; k < cells; k++)
+			{
+				mixer.cells[k].dirty = false;
+			}
+		}
+		const double t1 = _now();
+
+		if(t1 - t0 < best)
+			best = t1 - t0;
+	}
+
+	_mixer_app_free(&mixer);
+	free(bufs);
+	free(shm);
+
+	return best / ((double)updates * cells);
+}
+
+// run all sections if none are given on command line
+static bool
+_bench_section(int argc, char **argv, const char *section)
+{
+	if(argc < 2)
+		return true;
+
+	for(int a = 1; a < argc; a++)
+	{
+		if(!strcmp(argv[a], section))
+			return true;
+	}
+
+	return false;
+}
+
+int
+main(int argc, char **argv)
+{
+	static const unsigned dims [] = {8, 32, 128, 256};
+	static const jack_nframes_t periods [] = {1024, 4096};
+
+	if(_bench_section(argc, argv, "audio"))
+	{
+		fprintf(stdout, "# audio mixer, ns per frame per cell\n");
+		fprintf(stdout, "%-10s %8s %10s %10s %10s %10s\n",
+			"matrix", "frames", "untiled", "tiled", "metered", "tile");
+
+		for(unsigned d = 0; d < sizeof(dims)/sizeof(dims[0]); d++)
+		{
+			for(unsigned p = 0; p < sizeof(periods)/sizeof(periods[0]); p++)
+			{
+				const unsigned n = dims[d];
+				const jack_nframes_t nframes = periods[p];
+				const jack_nframes_t tile = _audio_mixer_tile_auto(n);
+				char matrix [32];
+
+				snprintf(matrix, 32, "%ux%u", n, n);
+
+				const double untiled = _bench_audio_mixer(n, n, nframes, 0, 1, 0, false);
+				const double tiled = _bench_audio_mixer(n, n, nframes, tile, 1, 0, false);
+				const double metered = _bench_audio_mixer(n, n, nframes, 0, 1, 0, true); // as by default, untiled
+
+				fprintf(stdout, "%-10s %8"PRIu32" %10.4f %10.4f %10.4f %10"PRIu32"\n",
+					matrix, nframes, untiled, tiled, metered, tile);
+			}
+		}
+	}
+
+	if(_bench_section(argc, argv, "small"))
+	{
+		fprintf(stdout, "\n# small audio mixers, fixed per-cycle overhead dominates\n");
+		fprintf(stdout, "%-10s %8s %10s %10s\n",
+			"matrix", "frames", "ns/f/cell", "ns/cycle");
+
+		for(unsigned n = 1; n <= 8; n *= 2)
+		{
+			for(jack_nframes_t nframes = 64; nframes <= 256; nframes *= 4)
+			{
+				const double tiled = _bench_audio_mixer(n, n, nframes,
+					_audio_mixer_tile_auto(n), 1, 0, false);
+				char matrix [32];
+
+				snprintf(matrix, 32, "%ux%u", n, n);
+
+				fprintf(stdout, "%-10s %8"PRIu32" %10.4f %10.1f\n",
+					matrix, nframes, tiled, tiled * nframes * n * n);
+			}
+		}
+	}
+
+	if(_bench_section(argc, argv, "threads"))
+	{
+		fprintf(stdout, "\n# audio mixer 128x128, ns per frame per cell\n");
+		fprintf(stdout, "%-10s %8s %10s\n",
+			"threads", "frames", "tiled");
+
+		for(unsigned nthreads = 1; nthreads <= 8; nthreads *= 2)
+		{
+			for(jack_nframes_t nframes = 64; nframes <= 1024; nframes *= 4)
+			{
+				const double tiled = _bench_audio_mixer(128, 128, nframes,
+					_audio_mixer_tile_auto(128), nthreads, 0, false);
+
+				fprintf(stdout, "%-10u %8"PRIu32" %10.4f\n",
+					nthreads, nframes, tiled);
+			}
+		}
+	}
+
+	if(_bench_section(argc, argv, "autom"))
+	{
+		fprintf(stdout, "\n# audio mixer with cell automation, ns per frame per cell\n");
+		fprintf(stdout, "%-10s %8s %10s %10s\n",
+			"matrix", "frames", "events", "tiled");
+
+		for(unsigned n = 8; n <= 128; n *= 4)
+		{
+			for(jack_nframes_t nframes = 64; nframes <= 1024; nframes *= 4)
+			{
+				for(unsigned nautom = 0; nautom <= 256; nautom = nautom ? nautom*16 : 1)
+				{
+					const double tiled = _bench_audio_mixer(n, n, nframes,
+						_audio_mixer_tile_auto(n), 1, nautom, false);
+					char matrix [32];
+
+					snprintf(matrix, 32, "%ux%u", n, n);
+
+					fprintf(stdout, "%-10s %8"PRIu32" %10u %10.4f\n",
+						matrix, nframes, nautom, tiled);
+				}
+			}
+		}
+	}
+
+	if(_bench_section(argc, argv, "midi"))
+	{
+		fprintf(stdout, "\n# MIDI mixer, events per sink and cycle routed to all sources\n");
+		fprintf(stdout, "%-10s %8s %10s %10s %10s\n",
+			"matrix", "frames", "events", "ns/f/cell", "ns/event");
+
+		for(unsigned n = 8; n <= BENCH_MIDI_DIM_MAX; n *= 4)
+		{
+			for(jack_nframes_t nframes = 64; nframes <= 1024; nframes *= 4)
+			{
+				// all routed events of a cycle fit into each source port
+				for(unsigned nevents = 1;
+					(nevents <= BENCH_MIDI_EVENTS_MAX) && (nevents*n <= BENCH_EVENTS_MAX);
+					nevents *= 8)
+				{
+					double per_event;
+					const double ns = _bench_midi_mixer(n, nframes, nevents, &per_event);
+					char matrix [32];
+
+					snprintf(matrix, 32, "%ux%u", n, n);
+
+					fprintf(stdout, "%-10s %8"PRIu32" %10u %10.4f %10.2f\n",
+						matrix, nframes, nevents, ns, per_event);
+				}
+			}
+		}
+	}
+
+	if(_bench_section(argc, argv, "monitor"))
+	{
+		fprintf(stdout, "\n# monitors, ns per frame per sink\n");
+		fprintf(stdout, "%-10s %8s %10s %10s %10s %10s %10s %11s %10s %10s %10s %10s\n",
+			"sinks", "frames", "peak", "rms", "lufs", "true-peak", "spectrum", "correlation",
+			"cv", "events", "midi", "osc");
+
+		for(unsigned nsinks = 8; nsinks <= 128; nsinks *= 4)
+		{
+			for(jack_nframes_t nframes = 64; nframes <= 1024; nframes *= 4)
+			{
+				const unsigned nevents = 16;
+				const double peak = _bench_monitor(TYPE_AUDIO, MONITOR_PEAK, nsinks, nframes, 0);
+				const double rms = _bench_monitor(TYPE_AUDIO, MONITOR_RMS, nsinks, nframes, 0);
+				const double lufs = _bench_monitor(TYPE_AUDIO, MONITOR_LUFS, nsinks, nframes, 0);
+				const double true_peak = _bench_monitor(TYPE_AUDIO, MONITOR_TRUE_PEAK, nsinks, nframes, 0);
+				const double spectrum = _bench_monitor(TYPE_AUDIO, MONITOR_SPECTRUM, nsinks, nframes, 0);
+				const double correlation = _bench_monitor(TYPE_AUDIO, MONITOR_CORRELATION, nsinks, nframes, 0);
+				const double midi = _bench_monitor(TYPE_MIDI, MONITOR_PEAK, nsinks, nframes, nevents);
+#ifdef JACK_HAS_METADATA_API
+				const double cv = _bench_monitor(TYPE_CV, MONITOR_PEAK, nsinks, nframes, 0);
+				const double osc = _bench_monitor(TYPE_OSC, MONITOR_PEAK, nsinks, nframes, nevents);
+#else // no CV nor OSC ports without metadata
+				const double cv = NAN;
+				const double osc = NAN;
+#endif
+
+				fprintf(stdout, "%-10u %8"PRIu32" %10.4f %10.4f %10.4f %10.4f %10.4f %11.4f %10.4f %10u %10.4f %10.4f\n",
+					nsinks, nframes, peak, rms, lufs, true_peak, spectrum, correlation, cv, nevents,
+					midi, osc);
+			}
+		}
+	}
+
+	// consistency checks, fail the run instead of reporting timings
+	if(_bench_section(argc, argv, "check"))
+	{
+#ifdef JACK_HAS_METADATA_API
+		if(!_bench_cv_check())
+		{
+			fprintf(stderr, "CV history disagrees with blocks\n");
+			return -1;
+		}
+#endif
+	}
+
+	if(_bench_section(argc, argv, "scan"))
+	{
+		const unsigned nkernels = sizeof(bench_scans)/sizeof(bench_scans[0]);
+
+		fprintf(stdout, "\n# monitor scan kernels, 128 sinks, ns per frame per sink\n");
+		fprintf(stdout, "%-10s", "frames");
+		for(unsigned p = 0; p < nkernels; p++)
+		{
+			fprintf(stdout, " %10s", bench_scans[p].label);
+		}
+		fprintf(stdout, "\n");
+
+		for(jack_nframes_t nframes = 32; nframes <= 1024; nframes *= 2)
+		{
+			fprintf(stdout, "%-10"PRIu32, nframes);
+			for(unsigned p = 0; p < nkernels; p++)
+			{
+				fprintf(stdout, " %10.4f", _bench_scan(bench_scans[p].scan, 128, nframes));
+			}
+			fprintf(stdout, "\n");
+		}
+	}
+
+	if(_bench_section(argc, argv, "osc"))
+	{
+		fprintf(stdout, "\n# OSC automation of whole matrix, ns per cell\n");
+		fprintf(stdout, "%-10s %8s %10s %10s\n",
+			"matrix", "message", "ns/cell", "bytes");
+
+		for(unsigned n = 8; n <= BENCH_OSC_DIM_MAX; n *= 2)
+		{
+			for(bench_osc_t mode = BENCH_OSC_CELL; mode <= BENCH_OSC_BLOB; mode++)
+			{
+				size_t bytes;
+				const double ns = _bench_osc(n, mode, &bytes);
+				char matrix [32];
+
+				snprintf(matrix, 32, "%ux%u", n, n);
+
+				fprintf(stdout, "%-10s %8s %10.2f %10zu\n",
+					matrix, bench_osc_labels[mode], ns, bytes);
+			}
+		}
+	}
+
+	return 0;
+}
@@ -68,7 +68,7 @@ _client_get_or_set_pos_y(app_t *app, client_t *client, const char *property)
 #endif
 
 client_t *
-_client_add(app_t *app, const char *client_name, int client_flags)
+_client_add(app_t *app, const char *client_name, int client_flags, bool hosted)
 {
 	client_t *client = calloc(1, sizeof(client_t));
 	if(client)
@@ -76,6 +76,7 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		client->name = strdup(client_name);
 		client->pretty_name = NULL;
 		client->flags = client_flags;
+		client->hosted = hosted;
 
 		const float w = 200.f * app->scale;
 		const float h = 25.f * app->scale;
@@ -102,7 +103,10 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		client->pos = nk_vec2(x, *nxt);
 		client->dim = nk_vec2(w, h);
 
-		char *client_uuid_str = jack_get_uuid_for_client_name(app->client, client_name);
+		// instances of a host have no JACK client and thus no uuid of their own
+		char *client_uuid_str = hosted
+			? NULL
+			: jack_get_uuid_for_client_name(app->client, client_name);
 		if(client_uuid_str)
 		{
 			jack_uuid_parse(client_uuid_str, &client->uuid);
@@ -111,6 +115,7 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 		}
 
 #ifdef JACK_HAS_METADATA_API
+		if(!client->hosted)
 		{
 			char *value = NULL;
 			char *type = NULL;
@@ -124,7 +129,11 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 				jack_free(type);
 		}
 
-		if(client->flags == (JackPortIsInput | JackPortIsOutput) )
+		if(client->hosted)
+		{
+			// positions are not persisted for instances of a host
+		}
+		else if(client->flags == (JackPortIsInput | JackPortIsOutput) )
 		{
 			_client_get_or_set_pos_x(app, client, PATCHMATRIX__mainPositionX);
 			_client_get_or_set_pos_y(app, client, PATCHMATRIX__mainPositionY);
@@ -142,9 +151,9 @@ _client_add(app_t *app, const char *client_name, int client_flags)
 #endif
 
 		if(!strncmp(client_name, PATCHMATRIX_MONITOR_ID, strlen(PATCHMATRIX_MONITOR_ID)))
-			client->monitor_shm = _monitor_add(client_name);
+			client->monitor_shm = _monitor_add(client_name, &client->shm_size);
 		else if(!strncmp(client_name, PATCHMATRIX_MIXER_ID, strlen(PATCHMATRIX_MIXER_ID)))
-			client->mixer_shm = _mixer_add(client_name);
+			client->mixer_shm = _mixer_add(client_name, &client->shm_size);
 
 		_hash_add(&app->clients, client);
 	}
@@ -166,10 +175,13 @@ _client_free(app_t *app, client_t *client)
 	_hash_free(&client->sinks);
 
 	if(client->mixer_shm)
-		_mixer_free(client->mixer_shm);
+		_mixer_free(client->mixer_shm, client->shm_size);
 	else if(client->monitor_shm)
-		_monitor_free(client->monitor_shm);
+		_monitor_free(client->monitor_shm, client->shm_size);
 
+	free(client->levels);
+	free(client->bands);
+	free(client->rates);
 	free(client->name);
 	free(client->pretty_name);
 	free(client);
@@ -504,14 +516,30 @@ _port_add(app_t *app, jack_port_t *jport)
 	if(!sep)
 		return NULL;
 
+	const char *group = port_name;
 	const char *port_short_name = sep + 1;
-	char *client_name = strndup(port_name, sep - port_name);
+	bool hosted = false;
+
+	// ports of a host are grouped by instance, e.g. host:instance:sink_01
+	if(!strncmp(port_name, PATCHMATRIX_HOST_ID":", strlen(PATCHMATRIX_HOST_ID":")))
+	{
+		char *group_sep = strchr(port_short_name, ':');
+		if(group_sep)
+		{
+			group = port_short_name;
+			sep = group_sep;
+			port_short_name = sep + 1;
+			hosted = true;
+		}
+	}
+
+	char *client_name = strndup(group, sep - group);
 	if(!client_name)
 		return NULL;
 
 	client_t *client = _client_find_by_name(app, client_name, client_flags);
 	if(!client)
-		client = _client_add(app, client_name, client_flags);
+		client = _client_add(app, client_name, client_flags, hosted);
 	free(client_name);
 	if(!client)
 		return NULL;
@@ -734,10 +762,106 @@ _port_find_by_body(app_t *app, jack_port_t *body)
 	return NULL;
 }
 
+static void *
+_shm_map(const char *client_name, size_t min_size, size_t *size)
+{
+	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
+	if(fd == -1)
+		return NULL;
+
+	struct stat st;
+	shm_header_t *header;
+	if(  (fstat(fd, &st) == -1)
+		|| ((size_t)st.st_size < min_size)
+		|| ((header = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) )
+	{
+		close(fd);
+		return NULL;
+	}
+	close(fd);
+
+	if(  (header->version != SHM_VERSION)
+		|| (header->size != (size_t)st.st_size)
+		|| (header->nsinks > PORT_MAX)
+		|| (header->nsources > PORT_MAX) )
+	{
+		munmap(header, st.st_size);
+		return NULL;
+	}
+
+	*size = st.st_size;
+
+	return header;
+}
+
+// host
+static void
+_host_spawn(app_t *app)
+{
+	pthread_t pid = vfork();
+	if(pid == 0) // child
+	{
+		char *const argv [] = {
+			PATCHMATRIX_HOST,
+			app->server_name ? "-n" : NULL,
+			(char *)app->server_name,
+			NULL
+		};
+
+		execvp(argv[0], argv);
+		_exit(-errno);
+	}
+}
+
+static host_shm_t *
+_host_add(void)
+{
+	size_t size;
+	return _shm_map(PATCHMATRIX_HOST_ID, sizeof(host_shm_t), &size);
+}
+
+void
+_host_free(host_shm_t *host_shm)
+{
+	munmap(host_shm, sizeof(host_shm_t));
+}
+
+static int
+_host_spawn_request(app_t *app, host_kind_t kind, unsigned nsinks, unsigned nsources)
+{
+	// drop mapping of a host that has gone in the meantime
+	if(app->host_shm && atomic_load_explicit(&app->host_shm->closing, memory_order_relaxed))
+	{
+		_host_free(app->host_shm);
+		app->host_shm = NULL;
+	}
+
+	if(!app->host_shm && !(app->host_shm = _host_add()))
+	{
+		_host_spawn(app);
+
+		// give host some time to come up
+		for(unsigned ms = 0; !app->host_shm && (ms < 1000); ms += 10)
+		{
+			usleep(10000);
+			app->host_shm = _host_add();
+		}
+
+		if(!app->host_shm)
+			return -1;
+	}
+
+	return _host_request(app->host_shm, kind, app->type, nsinks, nsources,
+		app->metered);
+}
+
 // mixer
 void
 _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources)
 {
+	if(app->hosted && (_host_spawn_request(app, HOST_MIXER, nsinks, nsources) == 0) )
+		return;
+
 	pthread_t pid = vfork();
 	if(pid == 0) // child
 	{
@@ -755,6 +879,8 @@ _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources)
 			sink_nums,
 			"-o",
 			source_nums,
+			"-m",
+			app->metered ? "peak" : "none",
 			app->server_name ? "-n" : NULL,
 			(char *)app->server_name,
 			NULL
@@ -766,38 +892,36 @@ _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources)
 }
 
 mixer_shm_t *
-_mixer_add(const char *client_name)
+_mixer_add(const char *client_name, size_t *size)
 {
-	const size_t total_size = sizeof(mixer_shm_t);
-
-	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
-	if(fd == -1)
+	mixer_shm_t *mixer_shm = _shm_map(client_name, sizeof(mixer_shm_t), size);
+	if(!mixer_shm)
 		return NULL;
 
-	mixer_shm_t *mixer_shm;
-	if(  (ftruncate(fd, total_size) == -1)
-		|| ((mixer_shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) )
+	// segment only ever grows, so it may be larger than needed
+	const shm_header_t *header = &mixer_shm->header;
+	if(*size < _mixer_shm_size(header->nsinks, header->nsources))
 	{
-		close(fd);
+		munmap(mixer_shm, *size);
 		return NULL;
 	}
-	close(fd);
 
 	return mixer_shm;
 }
 
 void
-_mixer_free(mixer_shm_t *mixer_shm)
+_mixer_free(mixer_shm_t *mixer_shm, size_t size)
 {
-	const size_t total_size = sizeof(mixer_shm_t);
-
-	munmap(mixer_shm, total_size);
+	munmap(mixer_shm, size);
 }
 
 // monitor
 void
 _monitor_spawn(app_t *app, unsigned nsinks)
 {
+	if(app->hosted && (_host_spawn_request(app, HOST_MONITOR, nsinks, 0) == 0) )
+		return;
+
 	pthread_t pid = vfork();
 	if(pid == 0) // child
 	{
@@ -821,30 +945,49 @@ _monitor_spawn(app_t *app, unsigned nsinks)
 }
 
 monitor_shm_t *
-_monitor_add(const char *client_name)
+_monitor_add(const char *client_name, size_t *size)
 {
-	const size_t total_size = sizeof(monitor_shm_t);
-
-	const int fd = shm_open(client_name, O_RDWR, S_IRUSR | S_IWUSR);
-	if(fd == -1)
+	monitor_shm_t *monitor_shm = _shm_map(client_name, sizeof(monitor_shm_t), size);
+	if(!monitor_shm)
 		return NULL;
 
-	monitor_shm_t *monitor_shm;
-	if(  (ftruncate(fd, total_size) == -1)
-		|| ((monitor_shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) )
+	// segment only ever grows, so it may be larger than needed
+	const shm_header_t *header = &monitor_shm->header;
+	if(*size < _monitor_shm_size(header->nsinks))
 	{
-		close(fd);
+		munmap(monitor_shm, *size);
 		return NULL;
 	}
-	close(fd);
 
 	return monitor_shm;
 }
 
 void
-_monitor_free(monitor_shm_t *monitor_shm)
+_monitor_free(monitor_shm_t *monitor_shm, size_t size)
+{
+	munmap(monitor_shm, size);
+}
+
+static void
+_monitor_repair_client(client_t *client)
+{
+	monitor_shm_t *shm = client->monitor_shm;
+
+	if(shm && (shm->mode == MONITOR_CORRELATION))
+		_monitor_repair_request(shm);
+}
+
+void
+_monitors_repair(app_t *app, client_t *client)
 {
-	const size_t total_size = sizeof(monitor_shm_t);
+	// correlating monitors pair by designation of their sinks or what feeds them
+	_monitor_repair_client(client);
 
-	munmap(monitor_shm, total_size);
+	HASH_FOREACH(&app->conns, client_conn_itr)
+	{
+		client_conn_t *client_conn = *client_conn_itr;
+
+		if(client_conn->source_client == client)
+			_monitor_repair_client(client_conn->sink_client);
+	}
 }
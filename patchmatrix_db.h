@@ -22,7 +22,7 @@
 
 // client
 client_t *
-_client_add(app_t *app, const char *client_name, int client_flags);
+_client_add(app_t *app, const char *client_name, int client_flags, bool hosted);
 
 void
 _client_free(app_t *app, client_t *client);
@@ -103,24 +103,31 @@ _port_find_by_uuid(app_t *app, jack_uuid_t port_uuid);
 port_t *
 _port_find_by_body(app_t *app, jack_port_t *body);
 
+// host
+void
+_host_free(host_shm_t *host_shm);
+
 // mixer
 void
 _mixer_spawn(app_t *app, unsigned nsinks, unsigned nsources);
 
 mixer_shm_t *
-_mixer_add(const char *client_name);
+_mixer_add(const char *client_name, size_t *size);
 
 void
-_mixer_free(mixer_shm_t *mixer_shm);
+_mixer_free(mixer_shm_t *mixer_shm, size_t size);
 
 // monitor
 void
 _monitor_spawn(app_t *app, unsigned nsinks);
 
 monitor_shm_t *
-_monitor_add(const char *client_name);
+_monitor_add(const char *client_name, size_t *size);
+
+void
+_monitor_free(monitor_shm_t *monitor_shm, size_t size);
 
 void
-_monitor_free(monitor_shm_t *monitor_shm);
+_monitors_repair(app_t *app, client_t *client);
 
 #endif
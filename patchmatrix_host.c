@@ -0,0 +1,584 @@
+/*
+ * Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the iapplied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#include <pthread.h>
+
+#include <patchmatrix_mixer.h>
+#include <patchmatrix_monitor.h>
+
+#define HOST_INSTANCE_MAX 256
+
+typedef struct _instance_t instance_t;
+typedef struct _host_app_t host_app_t;
+
+struct _instance_t {
+	host_app_t *host;
+	host_kind_t kind;
+	unsigned slot; // in instance tables of host
+	pthread_t thread;
+	atomic_bool finished; // torn down, to be joined by main thread
+
+	JackProcessCallback process;
+	void *data;
+
+	union {
+		struct {
+			mixer_app_t app;
+			mixer_app_t next;
+		} mixer;
+		struct {
+			monitor_app_t app;
+			monitor_app_t next;
+		} monitor;
+	};
+};
+
+struct _host_app_t {
+	jack_client_t *client;
+	char name [NAME_MAX_LEN];
+	unsigned nthreads; // per audio or CV mixer
+	unsigned serial; // to name instances uniquely
+
+	int fd;
+	host_shm_t *shm;
+
+	_Atomic(instance_t *) rt [HOST_INSTANCE_MAX]; // run by RT thread
+	atomic_uint nrt; // high-water mark of the above
+	atomic_uint cycles; // completed by RT thread
+	atomic_bool active;
+
+	instance_t *instances [HOST_INSTANCE_MAX]; // main thread only
+};
+
+static void
+_close(host_shm_t *shm)
+{
+	atomic_store_explicit(&shm->closing, true, memory_order_relaxed);
+	sem_post(&shm->done);
+}
+
+static void
+_jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
+{
+	host_app_t *host = arg;
+
+	atomic_store_explicit(&host->active, false, memory_order_relaxed);
+	_close(host->shm);
+}
+
+static int
+_host_process(jack_nframes_t nframes, void *arg)
+{
+	host_app_t *host = arg;
+	const unsigned nrt = atomic_load_explicit(&host->nrt, memory_order_acquire);
+
+	// all instances run in this one process callback, in order of their slots
+	for(unsigned n = 0; n < nrt; n++)
+	{
+		instance_t *inst = atomic_load_explicit(&host->rt[n], memory_order_acquire);
+
+		if(inst)
+			inst->process(nframes, inst->data);
+	}
+
+	atomic_fetch_add_explicit(&host->cycles, 1, memory_order_release);
+
+	return 0;
+}
+
+static void
+_host_publish(host_app_t *host, instance_t *inst)
+{
+	atomic_store(&host->rt[inst->slot], inst);
+
+	if(inst->slot >= atomic_load_explicit(&host->nrt, memory_order_relaxed))
+		atomic_store_explicit(&host->nrt, inst->slot + 1, memory_order_release);
+}
+
+static void
+_host_unpublish(host_app_t *host, instance_t *inst)
+{
+	atomic_store(&host->rt[inst->slot], NULL);
+
+	// RT thread may still be running the instance in its current cycle, however
+	// long that stalls, freeing it before the cycle has completed is not an option
+	const unsigned cycles = atomic_load(&host->cycles);
+
+	while( atomic_load(&host->active)
+		&& (atomic_load(&host->cycles) == cycles) )
+	{
+		usleep(1000);
+	}
+}
+
+static void
+_instance_close(instance_t *inst)
+{
+	switch(inst->kind)
+	{
+		case HOST_MIXER:
+		{
+			mixer_app_t *mixer = &inst->mixer.app;
+
+			_audio_mixer_workers_stop(mixer);
+			_mixer_shm_close(mixer);
+			_mixer_ports_unregister(mixer);
+			_mixer_sched_free(mixer);
+			_mixer_app_free(mixer);
+		} break;
+		case HOST_MONITOR:
+		{
+			monitor_app_t *monitor = &inst->monitor.app;
+
+			_monitor_shm_close(monitor);
+			_monitor_ports_unregister(monitor);
+			_monitor_app_free(monitor);
+		} break;
+	}
+}
+
+static void *
+_instance_thread(void *data)
+{
+	instance_t *inst = data;
+	host_app_t *host = inst->host;
+
+	switch(inst->kind)
+	{
+		case HOST_MIXER:
+		{
+			_mixer_run(&inst->mixer.app, &inst->mixer.next, 0);
+		} break;
+		case HOST_MONITOR:
+		{
+			_monitor_run(&inst->monitor.app, &inst->monitor.next);
+		} break;
+	}
+
+	_host_unpublish(host, inst);
+	_instance_close(inst);
+
+	// have main thread join us
+	atomic_store_explicit(&inst->finished, true, memory_order_release);
+	sem_post(&host->shm->done);
+
+	return NULL;
+}
+
+static int
+_instance_mixer_open(host_app_t *host, instance_t *inst, port_type_t type,
+	unsigned nsinks, unsigned nsources, bool metered)
+{
+	mixer_app_t *mixer = &inst->mixer.app;
+
+	mixer->client = host->client;
+	mixer->type = type;
+	mixer->metered = metered && (type != TYPE_MIDI); // events have no peaks
+	mixer->tile = 0; // untiled, as standalone mixers by default
+	mixer->hosted = true;
+
+	if(_mixer_app_alloc(mixer, nsinks, nsources) == -1)
+		return -1;
+
+	if(_mixer_sched_alloc(mixer) == -1)
+	{
+		_mixer_app_free(mixer);
+		return -1;
+	}
+
+	// segment names must not clash with stale ones or those of other clients
+	do {
+		snprintf(mixer->name, NAME_MAX_LEN, "%s.%02u", PATCHMATRIX_MIXER_ID, ++host->serial);
+	} while( (_mixer_shm_open(mixer, O_EXCL) == -1) && (errno == EEXIST) );
+
+	if(!mixer->shm)
+	{
+		_mixer_sched_free(mixer);
+		_mixer_app_free(mixer);
+		return -1;
+	}
+
+	if(_mixer_ports_register(mixer) == -1)
+	{
+		_mixer_shm_close(mixer);
+		_mixer_ports_unregister(mixer);
+		_mixer_sched_free(mixer);
+		_mixer_app_free(mixer);
+		return -1;
+	}
+
+	if( (mixer->type != TYPE_MIDI)
+		&& (_audio_mixer_workers_start(mixer, host->nthreads) == -1) )
+	{
+		fprintf(stderr, "failed to start mixing threads\n");
+	}
+
+	inst->process = mixer->type == TYPE_MIDI ? _midi_mixer_process : _audio_mixer_process;
+	inst->data = mixer;
+
+	return 0;
+}
+
+static int
+_instance_monitor_open(host_app_t *host, instance_t *inst, port_type_t type,
+	unsigned nsinks)
+{
+	monitor_app_t *monitor = &inst->monitor.app;
+
+	monitor->client = host->client;
+	monitor->type = type;
+	monitor->hosted = true;
+	_monitor_sample_rate_init(monitor, jack_get_sample_rate(host->client));
+
+	if(_monitor_app_alloc(monitor, nsinks) == -1)
+		return -1;
+
+	do {
+		snprintf(monitor->name, NAME_MAX_LEN, "%s.%02u", PATCHMATRIX_MONITOR_ID, ++host->serial);
+	} while( (_monitor_shm_open(monitor, O_EXCL) == -1) && (errno == EEXIST) );
+
+	if(!monitor->shm)
+	{
+		_monitor_app_free(monitor);
+		return -1;
+	}
+
+	if(_monitor_ports_register(monitor) == -1)
+	{
+		_monitor_shm_close(monitor);
+		_monitor_ports_unregister(monitor);
+		_monitor_app_free(monitor);
+		return -1;
+	}
+
+	inst->process = _monitor_process_callback(monitor->type);
+	inst->data = monitor;
+
+	return 0;
+}
+
+static int
+_instance_add(host_app_t *host, const host_request_t *req)
+{
+	unsigned slot;
+	for(slot = 0; (slot < HOST_INSTANCE_MAX) && host->instances[slot]; slot++)
+	{}
+
+	if(slot == HOST_INSTANCE_MAX)
+		return -1;
+
+	instance_t *inst = calloc(1, sizeof(instance_t));
+	if(!inst)
+		return -1;
+
+	inst->host = host;
+	inst->kind = req->kind;
+	inst->slot = slot;
+	atomic_init(&inst->finished, false);
+
+	const unsigned nsinks = req->nsinks > PORT_MAX ? PORT_MAX : req->nsinks;
+	const unsigned nsources = req->nsources > PORT_MAX ? PORT_MAX : req->nsources;
+
+	int ret = -1;
+	switch(req->kind)
+	{
+		case HOST_MIXER:
+		{
+			ret = _instance_mixer_open(host, inst, req->type, nsinks, nsources,
+				req->metered);
+		} break;
+		case HOST_MONITOR:
+		{
+			ret = _instance_monitor_open(host, inst, req->type, nsinks);
+		} break;
+	}
+
+	if(ret == -1)
+	{
+		free(inst);
+		return -1;
+	}
+
+	// publish before instance thread may tear it down again
+	host->instances[slot] = inst;
+	_host_publish(host, inst);
+
+	if(pthread_create(&inst->thread, NULL, _instance_thread, inst) != 0)
+	{
+		_host_unpublish(host, inst);
+		_instance_close(inst);
+		host->instances[slot] = NULL;
+		free(inst);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_instance_reap(host_app_t *host, bool wait)
+{
+	for(unsigned slot = 0; slot < HOST_INSTANCE_MAX; slot++)
+	{
+		instance_t *inst = host->instances[slot];
+
+		if(!inst)
+			continue;
+
+		if(!wait && !atomic_load_explicit(&inst->finished, memory_order_acquire))
+			continue;
+
+		pthread_join(inst->thread, NULL);
+		host->instances[slot] = NULL;
+		free(inst);
+	}
+}
+
+static void
+_instance_close_all(host_app_t *host)
+{
+	// RT thread has stopped, so shm of instances cannot be swapped anymore
+	for(unsigned slot = 0; slot < HOST_INSTANCE_MAX; slot++)
+	{
+		instance_t *inst = host->instances[slot];
+
+		if(!inst || atomic_load_explicit(&inst->finished, memory_order_acquire))
+			continue;
+
+		atomic_bool *closing = NULL;
+		sem_t *done = NULL;
+
+		switch(inst->kind)
+		{
+			case HOST_MIXER:
+			{
+				closing = &inst->mixer.app.shm->closing;
+				done = &inst->mixer.app.shm->done;
+			} break;
+			case HOST_MONITOR:
+			{
+				closing = &inst->monitor.app.shm->closing;
+				done = &inst->monitor.app.shm->done;
+			} break;
+		}
+
+		atomic_store_explicit(closing, true, memory_order_relaxed);
+		sem_post(done);
+	}
+
+	_instance_reap(host, true);
+}
+
+static int
+_host_shm_open(host_app_t *host)
+{
+	const size_t size = sizeof(host_shm_t);
+
+	host->fd = shm_open(host->name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if(host->fd == -1)
+		return -1;
+
+	if(  (ftruncate(host->fd, size) == -1)
+		|| ((host->shm = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, host->fd, 0)) == MAP_FAILED) )
+	{
+		host->shm = NULL;
+		close(host->fd);
+		shm_unlink(host->name);
+		return -1;
+	}
+
+	_shm_header_init(&host->shm->header, size, TYPE_NONE, 0, 0);
+
+	atomic_init(&host->shm->closing, false);
+
+	for(unsigned r = 0; r < HOST_REQUEST_MAX; r++)
+		atomic_init(&host->shm->requests[r].slot, HOST_SLOT_FREE);
+
+	if(sem_init(&host->shm->done, 1, 0) == -1)
+	{
+		munmap(host->shm, size);
+		host->shm = NULL;
+		close(host->fd);
+		shm_unlink(host->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_host_shm_close(host_app_t *host)
+{
+	sem_destroy(&host->shm->done);
+	munmap(host->shm, sizeof(host_shm_t));
+	host->shm = NULL;
+
+	close(host->fd);
+	shm_unlink(host->name);
+}
+
+static void
+_host_run(host_app_t *host)
+{
+	while(true)
+	{
+		sem_wait(&host->shm->done);
+
+		if(atomic_load_explicit(&host->shm->closing, memory_order_relaxed))
+			break;
+
+		_instance_reap(host, false);
+
+		for(unsigned r = 0; r < HOST_REQUEST_MAX; r++)
+		{
+			host_request_t *req = &host->shm->requests[r];
+
+			if(atomic_load_explicit(&req->slot, memory_order_acquire) != HOST_SLOT_READY)
+				continue;
+
+			const host_request_t copy = {
+				.kind = req->kind,
+				.type = req->type,
+				.nsinks = req->nsinks,
+				.nsources = req->nsources,
+				.metered = req->metered
+			};
+
+			atomic_store_explicit(&req->slot, HOST_SLOT_FREE, memory_order_release);
+
+			if(_instance_add(host, &copy) == -1)
+			{
+				fprintf(stderr, "failed to add instance\n");
+			}
+		}
+	}
+
+	atomic_store_explicit(&host->shm->closing, true, memory_order_relaxed);
+}
+
+int
+main(int argc, char **argv)
+{
+	static host_app_t host;
+
+	const char *server_name = NULL;
+	host.nthreads = 1;
+
+	fprintf(stderr,
+		"%s "PATCHMATRIX_VERSION"\n"
+		"Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)\n"
+		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
+
+	int c;
+	while((c = getopt(argc, argv, "vhj:n:")) != -1)
+	{
+		switch(c)
+		{
+			case 'v':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"This is free software: you can redistribute it and/or modify\n"
+					"it under the terms of the Artistic License 2.0 as published by\n"
+					"The Perl Foundation.\n"
+					"\n"
+					"This source is distributed in the hope that it will be useful,\n"
+					"but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+					"MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the\n"
+					"Artistic License 2.0 for more details.\n"
+					"\n"
+					"You should have received a copy of the Artistic License 2.0\n"
+					"along the source as a COPYING file. If not, obtain it from\n"
+					"http://www.perlfoundation.org/artistic_license_2_0.\n\n");
+				return 0;
+			case 'h':
+				fprintf(stderr,
+					"--------------------------------------------------------------------\n"
+					"USAGE\n"
+					"   %s [OPTIONS]\n"
+					"\n"
+					"OPTIONS\n"
+					"   [-v]                 print version and full license information\n"
+					"   [-h]                 print usage information\n"
+					"   [-j] thread-num      number of threads per audio or CV mixer (1-%i)\n"
+					"   [-n] server-name     connect to named JACK daemon\n\n"
+					, argv[0], MIXER_THREADS_MAX);
+				return 0;
+			case 'n':
+				server_name = optarg;
+				break;
+			case 'j':
+				host.nthreads = atoi(optarg);
+				if(host.nthreads < 1)
+					host.nthreads = 1;
+				else if(host.nthreads > MIXER_THREADS_MAX)
+					host.nthreads = MIXER_THREADS_MAX;
+				break;
+			case '?':
+				if( (optopt == 'n') || (optopt == 'j') )
+					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
+				else if(isprint(optopt))
+					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
+				else
+					fprintf(stderr, "Unknown option character `\\x%x'.\n", optopt);
+				return -1;
+			default:
+				return -1;
+		}
+	}
+
+	// UI finds host by its name, so there is only one per JACK daemon
+	jack_options_t opts = JackNullOption | JackNoStartServer | JackUseExactName;
+	if(server_name)
+		opts |= JackServerName;
+
+	jack_status_t status;
+	host.client = jack_client_open(PATCHMATRIX_HOST_ID, opts, &status,
+		server_name ? server_name : NULL);
+	if(!host.client)
+	{
+		fprintf(stderr, "failed to open JACK client, is a host running already?\n");
+		return -1;
+	}
+
+	snprintf(host.name, NAME_MAX_LEN, "%s", jack_get_client_name(host.client));
+
+	if(_host_shm_open(&host) == 0)
+	{
+		jack_on_info_shutdown(host.client, _jack_on_info_shutdown_cb, &host);
+		jack_set_process_callback(host.client, _host_process, &host);
+
+		atomic_init(&host.active, true);
+		jack_activate(host.client);
+
+		_host_run(&host);
+
+		jack_deactivate(host.client);
+		atomic_store(&host.active, false);
+
+		atomic_store_explicit(&closed, true, memory_order_relaxed);
+		atomic_store_explicit(&monitor_closed, true, memory_order_relaxed);
+
+		_instance_close_all(&host);
+
+		_host_shm_close(&host);
+	}
+
+	jack_client_close(host.client);
+
+	return 0;
+}
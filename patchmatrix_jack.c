@@ -73,8 +73,17 @@ _jack_anim(app_t *app)
 						port_t *port = _port_find_by_body(app, jport);
 						if(port)
 						{
+							client_t *client = port->client;
+
 							_port_remove(app, port);
 							_port_free(port);
+
+							// instances of a host never unregister as JACK clients
+							if(client->hosted && _hash_empty(&client->ports))
+							{
+								_client_remove(app, client);
+								_client_free(app, client);
+							}
 						}
 					}
 				}
@@ -100,6 +109,8 @@ _jack_anim(app_t *app)
 							else
 								_port_conn_remove(app, client_conn, source_port, sink_port);
 						}
+
+						_monitors_repair(app, sink_port->client);
 					}
 				}
 
@@ -193,7 +204,7 @@ _jack_anim(app_t *app)
 									if(port)
 									{
 										port->designation = _designation_get(value);
-										//FIXME do something?
+										_monitors_repair(app, port->client);
 									}
 								}
 								else if(!strcmp(ev->property_change.key, PATCHMATRIX__mainPositionX))
@@ -327,7 +338,7 @@ _jack_anim(app_t *app)
 								if(needs_designation_update)
 								{
 									port->designation = DESIGNATION_NONE;
-									//FIXME do something?
+									_monitors_repair(app, port->client);
 								}
 							}
 							else if((client = _client_find_by_uuid(app, ev->property_change.uuid,
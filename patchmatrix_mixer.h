@@ -0,0 +1,2516 @@
+/*
+ * Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This source is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the iapplied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the source as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _PATCHMATRIX_MIXER_H
+#define _PATCHMATRIX_MIXER_H
+
+#include <patchmatrix.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+
+#include <jack/thread.h>
+
+#define MIXER_NET_PACKET_MAX 0x10000 // largest OSC datagram to receive in one piece
+#define LV2_OSC_STREAM_REQBUF MIXER_NET_PACKET_MAX
+
+#include <osc.lv2/reader.h>
+#include <osc.lv2/stream.h>
+
+typedef struct _mixer_cell_t mixer_cell_t;
+typedef struct _mixer_worker_t mixer_worker_t;
+typedef struct _mixer_head_t mixer_head_t;
+typedef struct _mixer_item_t mixer_item_t;
+typedef struct _mixer_slot_t mixer_slot_t;
+typedef struct _mixer_sched_t mixer_sched_t;
+typedef struct _mixer_rec_t mixer_rec_t;
+typedef struct _mixer_net_t mixer_net_t;
+typedef struct _mixer_app_t mixer_app_t;
+
+#define MIXER_CACHE_SIZE 0x8000 // 32K L1 data cache assumed when sizing frame tiles
+#define MIXER_TILE_MIN 64 // smaller tiles do not amortize the per-cell overhead
+#define MIXER_TILE_ALIGN 16 // keep frame tiles a multiple of the SIMD width
+#define MIXER_THREADS_MAX 64
+#define MIXER_SCHED_MAX 512 // OSC bundle elements to be applied in future cycles
+#define MIXER_SCHED_SIZE 0x10000 // bytes of OSC bundle elements to be applied in future cycles
+#define MIXER_SCHED_HORIZON 0x40000000 // frames to schedule ahead at most, keeps frame comparisons unambiguous
+#define NTP_UNIX_OFFSET 2208988800LL // seconds from 1900 to 1970
+#define MIXER_NET_SIZE 0x80000 // bytes of received OSC messages in flight to process thread
+#define MIXER_NET_DRAIN_MAX 64 // received OSC messages to apply per cycle at most
+#define MIXER_NET_POLL 100 // ms to wait for socket at most, bounds latency of quitting
+#define MIXER_NET_STALL 1 // ms to back off while ring is full
+
+struct _mixer_cell_t {
+	int32_t mBFS; // gain currently ramped to, per-mille in CV mode
+	float gain; // linear gain at start of cycle
+	float target; // linear gain at end of cycle
+	float final; // linear gain at end of scene crossfade
+	float inc; // linear gain increment per frame while ramping
+	jack_nframes_t from; // frame offset of first gain change in cycle
+	bool dirty; // gain has been changed by automation in this cycle
+};
+
+struct _mixer_worker_t {
+	mixer_app_t *mixer;
+	jack_native_thread_t thread;
+	sem_t start;
+	unsigned from; // first source port to mix
+	unsigned to; // last source port to mix + 1
+	unsigned sfrom; // first sink port to meter
+	unsigned sto; // last sink port to meter + 1
+};
+
+struct _mixer_head_t {
+	jack_midi_event_t ev; // cached next event of this sink port
+	void *buf;
+	uint32_t count;
+	uint32_t pos;
+	unsigned i; // sink port index, automation port comes last
+};
+
+struct _mixer_item_t {
+	uint32_t size; // of whole item in ring, a multiple of its alignment
+	uint32_t done; // already applied, or padding up to end of ring
+	alignas(8) uint8_t body [];
+};
+
+struct _mixer_slot_t {
+	jack_nframes_t frame; // absolute frame to apply item at
+	uint32_t seq; // keeps items of same frame in order of arrival
+	uint32_t offset; // of item in ring
+	uint32_t size; // of OSC packet in item
+};
+
+struct _mixer_sched_t {
+	jack_nframes_t frames; // absolute frame at start of current cycle
+	jack_nframes_t nframes;
+	jack_time_t usecs; // at start of current cycle
+	jack_time_t period; // of current cycle in usecs
+	int64_t offset; // of wall clock to JACK clock in usecs
+	bool valid; // cycle times are known, else bundles are applied immediately
+
+	uint32_t seq;
+	unsigned nslots;
+	mixer_slot_t slots [MIXER_SCHED_MAX]; // min-heap by frame
+
+	uint32_t head; // offset of next item to write in ring
+	uint32_t tail; // offset of oldest item in ring
+	uint32_t used; // bytes taken in ring
+	alignas(8) uint8_t ring [MIXER_SCHED_SIZE];
+};
+
+struct _mixer_rec_t {
+	uint64_t timetag; // of innermost enclosing bundle, 1 if none
+	uint8_t body []; // checked OSC message
+};
+
+struct _mixer_net_t {
+	LV2_OSC_Stream stream;
+	varchunk_t *rx; // checked OSC messages from listener to process thread
+	pthread_t thread;
+	atomic_bool quit;
+	alignas(8) uint8_t buf [MIXER_NET_PACKET_MAX]; // packet currently received
+};
+
+struct _mixer_app_t {
+	jack_client_t *client;
+	jack_port_t *jautom;
+	jack_port_t **jsinks; // [nsinks]
+	jack_port_t **jsources; // [nsources]
+	port_type_t type;
+	unsigned nsinks;
+	unsigned nsources;
+
+	int16_t nrpn [0x10];
+	int16_t data [0x10];
+
+	mixer_cell_t *cells; // [nsources][nsinks]
+	unsigned *nactive; // [nsources]
+	uint16_t *active; // [nsources][nsinks]
+	jack_nframes_t tile;
+
+	float **psources; // [nsources]
+	const float **psinks; // [nsinks]
+	jack_nframes_t nframes;
+
+	mixer_head_t *heads; // [nsinks + 1]
+	unsigned *ndests; // [nsinks]
+	uint16_t *dests; // [nsinks][nsources]
+	uint8_t *vels; // [nsources][nsinks][0x80], MIDI only
+	bool metered; // peaks of sinks and sources are held in shm
+	float *peaks; // [nsinks + nsources] of current cycle, metered only
+	unsigned *meters; // [nsinks] source whose cell meters sink while mixing it, metered only
+	monitor_scan_t scan; // extremes kernel of monitors picked for this CPU
+
+	void *mem; // backs all of the above
+	size_t mem_size;
+
+	atomic_int sync; // handshake with main thread for resizing
+	bool frozen; // do not touch shm while main thread lays it out anew
+	jack_nframes_t fade; // frames left of scene crossfade
+	mixer_app_t *next; // state prepared by main thread to swap in
+
+	unsigned nworkers;
+	mixer_worker_t workers [MIXER_THREADS_MAX - 1];
+	sem_t done;
+	atomic_bool quit;
+
+	mixer_shm_t *shm;	
+	mixer_sched_t *sched; // not swapped, outlives resizes
+	mixer_net_t *net; // not swapped, outlives resizes
+
+	// main thread only
+	char name [NAME_MAX_LEN]; // of shm segment, port group when hosted
+	bool hosted; // shares JACK client with other instances
+	int fd; // of shm segment
+	size_t shm_size; // of current mapping
+};
+
+static atomic_bool closed = ATOMIC_VAR_INIT(false);
+
+static inline void *
+_mixer_carve(uint8_t *mem, size_t *offset, size_t size)
+{
+	void *ptr = mem ? mem + *offset : NULL;
+
+	// keep every array on its own cache lines
+	*offset += (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+
+	return ptr;
+}
+
+static inline size_t
+_mixer_app_layout(mixer_app_t *mixer, uint8_t *mem)
+{
+	const size_t nsinks = mixer->nsinks;
+	const size_t nsources = mixer->nsources;
+	size_t offset = 0;
+
+	mixer->jsinks = _mixer_carve(mem, &offset, nsinks*sizeof(jack_port_t *));
+	mixer->jsources = _mixer_carve(mem, &offset, nsources*sizeof(jack_port_t *));
+	mixer->cells = _mixer_carve(mem, &offset, nsources*nsinks*sizeof(mixer_cell_t));
+	mixer->nactive = _mixer_carve(mem, &offset, nsources*sizeof(unsigned));
+	mixer->active = _mixer_carve(mem, &offset, nsources*nsinks*sizeof(uint16_t));
+	mixer->psources = _mixer_carve(mem, &offset, nsources*sizeof(float *));
+	mixer->psinks = _mixer_carve(mem, &offset, nsinks*sizeof(const float *));
+	mixer->heads = _mixer_carve(mem, &offset, (nsinks + 1)*sizeof(mixer_head_t));
+	mixer->ndests = _mixer_carve(mem, &offset, nsinks*sizeof(unsigned));
+	mixer->dests = _mixer_carve(mem, &offset, nsinks*nsources*sizeof(uint16_t));
+	mixer->vels = _mixer_carve(mem, &offset,
+		mixer->type == TYPE_MIDI ? nsources*nsinks*0x80 : 0);
+	mixer->peaks = _mixer_carve(mem, &offset,
+		mixer->metered ? (nsinks + nsources)*sizeof(float) : 0);
+	mixer->meters = _mixer_carve(mem, &offset,
+		mixer->metered ? nsinks*sizeof(unsigned) : 0);
+
+	return offset;
+}
+
+static inline int
+_mixer_app_alloc(mixer_app_t *mixer, unsigned nsinks, unsigned nsources)
+{
+	mixer->nsinks = nsinks;
+	mixer->nsources = nsources;
+	mixer->mem_size = _mixer_app_layout(mixer, NULL);
+
+	if(posix_memalign(&mixer->mem, SHM_CACHE_LINE, mixer->mem_size) != 0)
+	{
+		mixer->mem = NULL;
+		return -1;
+	}
+
+	memset(mixer->mem, 0x0, mixer->mem_size);
+	_mixer_app_layout(mixer, mixer->mem);
+	mixer->scan = _audio_monitor_scan_select();
+
+	// keep RT thread off page faults, best effort within RLIMIT_MEMLOCK
+	mlock(mixer->mem, mixer->mem_size);
+
+	return 0;
+}
+
+static inline void
+_mixer_app_free(mixer_app_t *mixer)
+{
+	if(!mixer->mem)
+		return;
+
+	munlock(mixer->mem, mixer->mem_size);
+	free(mixer->mem);
+	mixer->mem = NULL;
+}
+
+static inline void
+_mixer_app_swap(mixer_app_t *mixer, mixer_app_t *next)
+{
+#define MIXER_SWAP(FIELD) \
+	do { \
+		__typeof__(mixer->FIELD) tmp = mixer->FIELD; \
+		mixer->FIELD = next->FIELD; \
+		next->FIELD = tmp; \
+	} while(0)
+
+	MIXER_SWAP(jsinks);
+	MIXER_SWAP(jsources);
+	MIXER_SWAP(nsinks);
+	MIXER_SWAP(nsources);
+	MIXER_SWAP(cells);
+	MIXER_SWAP(nactive);
+	MIXER_SWAP(active);
+	MIXER_SWAP(tile);
+	MIXER_SWAP(psources);
+	MIXER_SWAP(psinks);
+	MIXER_SWAP(heads);
+	MIXER_SWAP(ndests);
+	MIXER_SWAP(dests);
+	MIXER_SWAP(vels);
+	MIXER_SWAP(peaks);
+	MIXER_SWAP(meters);
+	MIXER_SWAP(mem);
+	MIXER_SWAP(mem_size);
+	MIXER_SWAP(shm);
+
+#undef MIXER_SWAP
+}
+
+static inline void
+_mixer_sync_handle(mixer_app_t *mixer)
+{
+	int state = atomic_load_explicit(&mixer->sync, memory_order_acquire);
+
+	switch(state)
+	{
+		case SYNC_NONE:
+		{
+			mixer->frozen = false;
+		} break;
+		case SYNC_FREEZE:
+		{
+			// main thread may have given up waiting in the meantime
+			mixer->frozen = atomic_compare_exchange_strong_explicit(&mixer->sync,
+				&state, SYNC_FROZEN, memory_order_acq_rel, memory_order_acquire);
+		} break;
+		case SYNC_FROZEN:
+		{
+			mixer->frozen = true;
+		} break;
+		case SYNC_SWAP:
+		{
+			_mixer_app_swap(mixer, mixer->next);
+			mixer->frozen = false;
+			mixer->fade = 0; // cells have been set to their final gains
+
+			atomic_store_explicit(&mixer->sync, SYNC_NONE, memory_order_release);
+		} break;
+	}
+}
+
+static inline void
+_mixer_bank_handle(mixer_app_t *mixer)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	if(mixer->frozen || !atomic_load_explicit(&shm->flip, memory_order_acquire))
+		return;
+
+	// flip to scene prepared by main thread in idle gain matrix
+	const uint32_t bank = atomic_load_explicit(&shm->bank, memory_order_relaxed);
+
+	mixer->fade = atomic_load_explicit(&shm->fade, memory_order_relaxed);
+	atomic_store_explicit(&shm->bank, bank ^ 1, memory_order_release);
+	atomic_store_explicit(&shm->flip, 0, memory_order_release);
+}
+
+static inline mixer_cell_t *
+_mixer_cell(mixer_app_t *mixer, unsigned nsource, unsigned nsink)
+{
+	return &mixer->cells[nsource*mixer->nsinks + nsink];
+}
+
+static inline uint16_t *
+_mixer_active(mixer_app_t *mixer, unsigned nsource)
+{
+	return &mixer->active[nsource*mixer->nsinks];
+}
+
+static inline uint16_t *
+_mixer_dests(mixer_app_t *mixer, unsigned nsink)
+{
+	return &mixer->dests[nsink*mixer->nsources];
+}
+
+static inline uint8_t *
+_mixer_vels(mixer_app_t *mixer, unsigned nsource, unsigned nsink)
+{
+	return &mixer->vels[(nsource*mixer->nsinks + nsink)*0x80];
+}
+
+static inline float
+_gain_from_mBFS(int32_t mBFS)
+{
+	if(mBFS <= -3600) // connection not to be mixed
+	{
+		return 0.f;
+	}
+
+	return exp10f(mBFS / 2000.f); // mBFS = 2000*log10(gain)
+}
+
+static inline float
+_gain_from_permil(int32_t permil)
+{
+	return (float)permil / MIXER_CV_UNITY;
+}
+
+static inline bool
+_mixer_is_cv(mixer_app_t *mixer)
+{
+#ifdef JACK_HAS_METADATA_API
+	return mixer->type == TYPE_CV;
+#else
+	return false;
+#endif
+}
+
+static inline float
+_mixer_gain(mixer_app_t *mixer, int32_t jgain)
+{
+	return _mixer_is_cv(mixer)
+		? _gain_from_permil(jgain)
+		: _gain_from_mBFS(jgain);
+}
+
+static inline int32_t
+_mixer_default(mixer_app_t *mixer, unsigned nsource, unsigned nsink)
+{
+	// route sinks straight through to sources by default
+	if(_mixer_is_cv(mixer))
+		return (nsource == nsink) ? MIXER_CV_UNITY : 0;
+
+	return (nsource == nsink) ? 0 : -3600;
+}
+
+static inline int32_t
+_mixer_range(mixer_app_t *mixer)
+{
+	return _mixer_is_cv(mixer)
+		? MIXER_CV_UNITY
+		: 3600;
+}
+
+static inline void
+_midi_cell_update(mixer_app_t *mixer, unsigned j, unsigned i)
+{
+	const float gain = _gain_from_mBFS(_mixer_cell(mixer, j, i)->mBFS);
+	uint8_t *vels = _mixer_vels(mixer, j, i);
+
+	for(unsigned v = 0; v < 0x80; v++)
+	{
+		const float vel = v * gain;
+
+		vels[v] = vel > 0x7f ? 0x7f : vel;
+	}
+}
+
+static inline void
+_midi_dests_update(mixer_app_t *mixer, unsigned i)
+{
+	mixer->ndests[i] = 0;
+
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		if(_mixer_cell(mixer, j, i)->mBFS > -3600) // connection to be mixed
+		{
+			_mixer_dests(mixer, i)[mixer->ndests[i]++] = j;
+		}
+	}
+}
+
+static inline void
+_midi_mixer_refresh(mixer_app_t *mixer, bool force)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	for(unsigned i = 0; i < mixer->nsinks; i++)
+	{
+		bool changed = force;
+
+		for(unsigned j = 0; j < mixer->nsources; j++)
+		{
+			mixer_cell_t *cell = _mixer_cell(mixer, j, i);
+			const int32_t mBFS = atomic_load_explicit(_mixer_shm_gain(shm, j, i), memory_order_relaxed);
+
+			if(force || (mBFS != cell->mBFS))
+			{
+				cell->mBFS = mBFS;
+				_midi_cell_update(mixer, j, i);
+				changed = true;
+			}
+		}
+
+		if(changed)
+		{
+			_midi_dests_update(mixer, i);
+		}
+	}
+}
+
+// returns true if MIDI destinations of sink need to be updated
+static inline bool
+_gain_store(mixer_app_t *mixer, uint32_t nsource, uint32_t nsink, int32_t mBFS,
+	jack_nframes_t time)
+{
+	mixer_shm_t *shm = mixer->shm;
+
+	if( (nsource >= mixer->nsources) || (nsink >= mixer->nsinks) )
+	{
+		return false;
+	}
+
+	if(mixer->frozen) // shm is being laid out anew
+	{
+		return false;
+	}
+
+	const int32_t range = _mixer_range(mixer);
+
+	if(mBFS < -range)
+		mBFS = -range;
+	else if(mBFS > range)
+		mBFS = range;
+
+	mixer_cell_t *cell = _mixer_cell(mixer, nsource, nsink);
+
+	if(!cell->dirty) // first change in this cycle starts the ramp
+	{
+		cell->from = time;
+		cell->dirty = true;
+	}
+
+	atomic_store_explicit(_mixer_shm_gain(shm, nsource, nsink), mBFS, memory_order_relaxed);
+
+	if( (mixer->type == TYPE_MIDI) && (mBFS != cell->mBFS) ) // applies to next event
+	{
+		cell->mBFS = mBFS;
+		_midi_cell_update(mixer, nsource, nsink);
+
+		return true;
+	}
+
+	return false;
+}
+
+static inline void
+_gain_set(mixer_app_t *mixer, uint32_t nsource, uint32_t nsink, int32_t mBFS,
+	jack_nframes_t time)
+{
+	if(_gain_store(mixer, nsource, nsink, mBFS, time))
+	{
+		_midi_dests_update(mixer, nsink);
+	}
+}
+
+static int
+_mixer_sched_alloc(mixer_app_t *mixer)
+{
+	void *mem;
+
+	if(posix_memalign(&mem, SHM_CACHE_LINE, sizeof(mixer_sched_t)) != 0)
+		return -1;
+
+	memset(mem, 0x0, sizeof(mixer_sched_t));
+	mlock(mem, sizeof(mixer_sched_t));
+	mixer->sched = mem;
+
+	return 0;
+}
+
+static void
+_mixer_sched_free(mixer_app_t *mixer)
+{
+	if(!mixer->sched)
+		return;
+
+	munlock(mixer->sched, sizeof(mixer_sched_t));
+	free(mixer->sched);
+	mixer->sched = NULL;
+}
+
+static inline void
+_mixer_sched_cycle(mixer_app_t *mixer, jack_nframes_t nframes)
+{
+	mixer_sched_t *sched = mixer->sched;
+	jack_time_t next;
+	float period;
+
+	if(!sched)
+		return;
+
+	sched->nframes = nframes;
+	sched->valid = (jack_get_cycle_times(mixer->client, &sched->frames,
+			&sched->usecs, &next, &period) == 0)
+		&& (next > sched->usecs);
+
+	if(!sched->valid)
+	{
+		sched->frames = jack_last_frame_time(mixer->client);
+		return;
+	}
+
+	sched->period = next - sched->usecs;
+
+	// relate timetags to JACK's clock once per cycle, reading both is RT-safe
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+
+	sched->offset = (int64_t)ts.tv_sec*1000000 + ts.tv_nsec/1000
+		- (int64_t)jack_get_time();
+}
+
+// frame relative to start of current cycle to apply bundle with timetag at
+static inline int64_t
+_mixer_sched_frame(mixer_sched_t *sched, uint64_t timetag, jack_nframes_t time)
+{
+	if(!sched || !sched->valid || (timetag == 1ULL)) // immediately
+		return time;
+
+	const int64_t sec = (int64_t)(timetag >> 32) - NTP_UNIX_OFFSET;
+	const int64_t usec = ((timetag & 0xffffffff) * 1000000) >> 32;
+	const int64_t dt = sec*1000000 + usec - sched->offset - (int64_t)sched->usecs;
+	const int64_t period = sched->period;
+
+	// clamp before scaling, timetags far off would overflow the product
+	if(dt < 0) // late
+		return time;
+	if(dt >= MIXER_SCHED_HORIZON * period / sched->nframes) // dropped by caller
+		return MIXER_SCHED_HORIZON;
+
+	return dt * sched->nframes / period;
+}
+
+static inline bool
+_mixer_slot_before(const mixer_slot_t *a, const mixer_slot_t *b)
+{
+	const int32_t df = a->frame - b->frame;
+
+	if(df != 0)
+		return df < 0;
+
+	return (int32_t)(a->seq - b->seq) < 0;
+}
+
+static inline void
+_mixer_sched_sift_up(mixer_sched_t *sched, unsigned c)
+{
+	const mixer_slot_t slot = sched->slots[c];
+
+	while(c > 0)
+	{
+		const unsigned p = (c - 1) / 2;
+
+		if(!_mixer_slot_before(&slot, &sched->slots[p]))
+			break;
+
+		sched->slots[c] = sched->slots[p];
+		c = p;
+	}
+
+	sched->slots[c] = slot;
+}
+
+static inline void
+_mixer_sched_sift_down(mixer_sched_t *sched, unsigned p)
+{
+	const mixer_slot_t slot = sched->slots[p];
+
+	while(true)
+	{
+		unsigned c = 2*p + 1;
+
+		if(c >= sched->nslots) // no children
+			break;
+
+		if( (c + 1 < sched->nslots) && _mixer_slot_before(&sched->slots[c + 1], &sched->slots[c]) )
+			c += 1; // right child is earlier
+
+		if(!_mixer_slot_before(&sched->slots[c], &slot))
+			break;
+
+		sched->slots[p] = sched->slots[c];
+		p = c;
+	}
+
+	sched->slots[p] = slot;
+}
+
+static inline mixer_item_t *
+_mixer_sched_reserve(mixer_sched_t *sched, uint32_t size)
+{
+	const uint32_t need = sizeof(mixer_item_t) + ((size + 7) & ~7U);
+
+	if(sched->used == 0) // start over at beginning of empty ring
+	{
+		sched->head = 0;
+		sched->tail = 0;
+	}
+	else if(sched->head == sched->tail) // full
+	{
+		return NULL;
+	}
+
+	if(sched->head >= sched->tail) // free space at end, and at beginning
+	{
+		if(sched->head + need > MIXER_SCHED_SIZE)
+		{
+			if(need > sched->tail) // fits neither
+				return NULL;
+
+			// pad up to end of ring and wrap around
+			mixer_item_t *pad = (mixer_item_t *)&sched->ring[sched->head];
+
+			pad->size = MIXER_SCHED_SIZE - sched->head;
+			pad->done = true;
+			sched->used += pad->size;
+			sched->head = 0;
+		}
+	}
+	else if(sched->head + need > sched->tail) // free space in between
+	{
+		return NULL;
+	}
+
+	mixer_item_t *item = (mixer_item_t *)&sched->ring[sched->head];
+
+	item->size = need;
+	item->done = false;
+	sched->used += need;
+	sched->head += need;
+
+	if(sched->head == MIXER_SCHED_SIZE)
+		sched->head = 0;
+
+	return item;
+}
+
+static inline void
+_mixer_sched_release(mixer_sched_t *sched, mixer_item_t *item)
+{
+	item->done = true;
+
+	// items are mostly applied in order of arrival, reclaim space up to first pending one
+	while(sched->used > 0)
+	{
+		mixer_item_t *tail = (mixer_item_t *)&sched->ring[sched->tail];
+
+		if(!tail->done)
+			break;
+
+		sched->used -= tail->size;
+		sched->tail += tail->size;
+
+		if(sched->tail == MIXER_SCHED_SIZE)
+			sched->tail = 0;
+	}
+}
+
+static inline bool
+_mixer_sched_push(mixer_sched_t *sched, int64_t frame, const uint8_t *body,
+	uint32_t size)
+{
+	if( (frame >= MIXER_SCHED_HORIZON) || (sched->nslots >= MIXER_SCHED_MAX) )
+		return false;
+
+	mixer_item_t *item = _mixer_sched_reserve(sched, size);
+	if(!item)
+		return false;
+
+	memcpy(item->body, body, size);
+
+	mixer_slot_t *slot = &sched->slots[sched->nslots];
+
+	slot->frame = sched->frames + frame;
+	slot->seq = sched->seq++;
+	slot->offset = (uint8_t *)item - sched->ring;
+	slot->size = size;
+
+	_mixer_sched_sift_up(sched, sched->nslots++);
+
+	return true;
+}
+
+// number of gains following as float arguments or as blob of big-endian floats
+static inline uint32_t
+_osc_gains_count(LV2_OSC_Reader *reader, const char *types)
+{
+	if(!strcmp(types, "b"))
+	{
+		int32_t len = 0;
+
+		if(  !lv2_osc_reader_get_int32(reader, &len) || (len < 0)
+			|| lv2_osc_reader_overflow(reader, len) )
+		{
+			return 0;
+		}
+
+		return len / sizeof(float); // reader now points to first gain
+	}
+
+	uint32_t n = 0;
+
+	while(types[n] == 'f')
+		n++;
+
+	return types[n] == '\0' ? n : 0;
+}
+
+// set n gains, the k-th one to cell at linear index from + k*stride
+static inline void
+_osc_gains_set(mixer_app_t *mixer, LV2_OSC_Reader *reader, uint32_t n,
+	uint32_t from, uint32_t stride, jack_nframes_t time)
+{
+	const uint32_t nsinks = mixer->nsinks;
+	bool changed = false;
+
+	for(uint32_t k = 0, c = from; k < n; k++, c += stride)
+	{
+		float mBFS = 0.f;
+
+		if(!lv2_osc_reader_get_float(reader, &mBFS))
+			break;
+
+		changed |= _gain_store(mixer, c / nsinks, c % nsinks, mBFS, time);
+	}
+
+	if(changed) // update MIDI destinations once per message
+	{
+		for(uint32_t i = 0; i < nsinks; i++)
+		{
+			_midi_dests_update(mixer, i);
+		}
+	}
+}
+
+static inline void
+_midi_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
+{
+	const uint8_t cmd = ev->buffer[0] & 0xf0;
+
+	if(cmd != 0xb0)
+	{
+		return;
+	}
+
+	const uint8_t chn = ev->buffer[0] & 0x0f;
+	const uint8_t ctr = ev->buffer[1];
+	const uint8_t val = ev->buffer[2];
+
+	switch(ctr)
+	{
+		case 0x62: // NRPN_LSB
+		{
+			mixer->nrpn[chn] &= 0x3f80;
+			mixer->nrpn[chn] |= val;
+		} break;
+		case 0x63: // NRPN_MSB
+		{
+			mixer->nrpn[chn] &= 0x7f;
+			mixer->nrpn[chn] |= (val << 7);
+		} break;
+		case 0x26: // DATA_LSB
+		{
+			mixer->data[chn] &= 0x3f80;
+			mixer->data[chn] |= val;
+		} break;
+		case 0x06: // DATA_MSB
+		{
+			mixer->data[chn] &= 0x7f;
+			mixer->data[chn] |= (val << 7);
+
+			const uint8_t nrpn_msb = mixer->nrpn[chn] >> 7;
+			const uint8_t nrpn_lsb = mixer->nrpn[chn] & 0x7f;
+			const int32_t mBFS = (float)(mixer->data[chn] - 0x1fff)/0x2000 * _mixer_range(mixer);
+
+			_gain_set(mixer, nrpn_msb, nrpn_lsb, mBFS, ev->time);
+		} break;
+	}
+}
+
+static inline void
+_osc_message_handle(mixer_app_t *mixer, LV2_OSC_Reader *reader,
+	jack_nframes_t time)
+{
+	const char *path = NULL;
+	const char *type= NULL;
+
+	lv2_osc_reader_get_string(reader, &path);
+	if(!path)
+		return;
+
+	lv2_osc_reader_get_string(reader, &type);
+	if(!type)
+		return;
+
+	if(!strcmp(path, "/patchmatrix/mixer/scene") && (!strcmp(type, ",i") || !strcmp(type, ",ii")))
+	{
+		int32_t slot = 0;
+		int32_t fade = 0;
+
+		lv2_osc_reader_get_int32(reader, &slot);
+		if(type[2] == 'i')
+			lv2_osc_reader_get_int32(reader, &fade);
+
+		if( (slot >= 0) && (fade >= 0) )
+			_mixer_scene_request(mixer->shm, slot, false, fade);
+
+		return;
+	}
+
+	if(!strcmp(path, "/patchmatrix/mixer/scene/store") && !strcmp(type, ",i"))
+	{
+		int32_t slot = 0;
+
+		lv2_osc_reader_get_int32(reader, &slot);
+
+		if(slot >= 0)
+			_mixer_scene_request(mixer->shm, slot, true, 0);
+
+		return;
+	}
+
+	if(!strcmp(path, "/patchmatrix/mixer/resize") && !strcmp(type, ",ii"))
+	{
+		int32_t nsinks = 0;
+		int32_t nsources = 0;
+
+		lv2_osc_reader_get_int32(reader, &nsinks);
+		lv2_osc_reader_get_int32(reader, &nsources);
+
+		if( (nsinks > 0) && (nsources > 0) )
+		{
+			mixer_shm_t *shm = mixer->shm;
+
+			_shm_resize_request(&shm->resize, &shm->done, nsinks, nsources);
+		}
+
+		return;
+	}
+
+	if(!strcmp(path, "/patchmatrix/mixer/row") && !strncmp(type, ",i", 2))
+	{
+		int32_t nsource = 0;
+
+		if(  !lv2_osc_reader_get_int32(reader, &nsource)
+			|| (nsource < 0) || ((uint32_t)nsource >= mixer->nsources) )
+		{
+			return;
+		}
+
+		uint32_t n = _osc_gains_count(reader, &type[2]);
+		if(n > mixer->nsinks)
+			n = mixer->nsinks;
+
+		_osc_gains_set(mixer, reader, n, nsource*mixer->nsinks, 1, time);
+
+		return;
+	}
+
+	if(!strcmp(path, "/patchmatrix/mixer/column") && !strncmp(type, ",i", 2))
+	{
+		int32_t nsink = 0;
+
+		if(  !lv2_osc_reader_get_int32(reader, &nsink)
+			|| (nsink < 0) || ((uint32_t)nsink >= mixer->nsinks) )
+		{
+			return;
+		}
+
+		uint32_t n = _osc_gains_count(reader, &type[2]);
+		if(n > mixer->nsources)
+			n = mixer->nsources;
+
+		_osc_gains_set(mixer, reader, n, nsink, mixer->nsinks, time);
+
+		return;
+	}
+
+	if(!strcmp(path, "/patchmatrix/mixer/matrix") && (type[0] == ','))
+	{
+		uint32_t n = _osc_gains_count(reader, &type[1]);
+		if(n > mixer->nsources*mixer->nsinks)
+			n = mixer->nsources*mixer->nsinks;
+
+		_osc_gains_set(mixer, reader, n, 0, 1, time);
+
+		return;
+	}
+
+	if(strcmp(path, "/patchmatrix/mixer") || strcmp(type, ",iif"))
+		return;
+
+	int32_t nsink = 0;
+	int32_t nsource = 0;
+	float mBFS = 0.f;
+
+	if(  !lv2_osc_reader_get_int32(reader, &nsink)
+		|| !lv2_osc_reader_get_int32(reader, &nsource)
+		|| !lv2_osc_reader_get_float(reader, &mBFS) )
+	{
+		return;
+	}
+
+	if( (nsink < 0) || (nsource < 0) )
+		return;
+
+	_gain_set(mixer, nsource, nsink, mBFS, time);
+}
+
+// true if message is one the mixer understands and all of its arguments are
+// there, checked off the process thread, indexes are bounded when applied
+static inline bool
+_osc_message_check(const uint8_t *body, size_t size)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	const char *path = NULL;
+	const char *type = NULL;
+
+	if(  !lv2_osc_reader_get_string(&reader, &path)
+		|| !lv2_osc_reader_get_string(&reader, &type)
+		|| (type[0] != ',') )
+	{
+		return false;
+	}
+
+	unsigned nints = 0; // leading indexes
+	bool gains = false; // followed by gains
+
+	if(!strcmp(path, "/patchmatrix/mixer") && !strcmp(type, ",iif"))
+	{
+		nints = 2;
+		gains = true;
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/row")
+		|| !strcmp(path, "/patchmatrix/mixer/column"))
+	{
+		nints = 1;
+		gains = true;
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/matrix"))
+	{
+		gains = true;
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/resize"))
+	{
+		nints = 2;
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/scene"))
+	{
+		nints = (type[1] && type[2]) ? 2 : 1; // with or without crossfade
+	}
+	else if(!strcmp(path, "/patchmatrix/mixer/scene/store"))
+	{
+		nints = 1;
+	}
+	else
+	{
+		return false;
+	}
+
+	for(unsigned k = 1; k <= nints; k++)
+	{
+		int32_t i = 0;
+
+		if(  (type[k] != 'i') || !lv2_osc_reader_get_int32(&reader, &i)
+			|| (i < 0) )
+		{
+			return false;
+		}
+	}
+
+	if(!gains)
+		return type[nints + 1] == '\0';
+
+	const uint32_t n = _osc_gains_count(&reader, &type[nints + 1]);
+
+	return (n > 0) && !lv2_osc_reader_overflow(&reader, n*sizeof(float));
+}
+
+static inline void
+_osc_packet_handle(mixer_app_t *mixer, const uint8_t *body, size_t size,
+	jack_nframes_t time)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		{
+			const int64_t frame = _mixer_sched_frame(mixer->sched, itm->timetag, time);
+
+			if(frame <= time) // due or late
+			{
+				_osc_packet_handle(mixer, itm->body, itm->size, time);
+			}
+			else // dropped when too far ahead or scheduler is full, rather than applied early
+			{
+				_mixer_sched_push(mixer->sched, frame, itm->body, itm->size);
+			}
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader))
+	{
+		_osc_message_handle(mixer, &reader, time);
+	}
+}
+
+// apply scheduled items due before given frame of current cycle
+static inline void
+_mixer_sched_apply(mixer_app_t *mixer, jack_nframes_t until)
+{
+	mixer_sched_t *sched = mixer->sched;
+
+	if(!sched || mixer->frozen) // keep items while gains are laid out anew
+		return;
+
+	while(sched->nslots > 0)
+	{
+		const mixer_slot_t slot = sched->slots[0];
+		const int32_t frame = slot.frame - sched->frames;
+
+		if(frame >= (int32_t)until)
+			break;
+
+		// pop before applying, as nested bundles may push anew
+		sched->slots[0] = sched->slots[--sched->nslots];
+		_mixer_sched_sift_down(sched, 0);
+
+		mixer_item_t *item = (mixer_item_t *)&sched->ring[slot.offset];
+
+		_osc_packet_handle(mixer, item->body, slot.size, frame < 0 ? 0 : frame);
+		_mixer_sched_release(sched, item);
+	}
+}
+
+static inline void
+_autom_handle(mixer_app_t *mixer, jack_midi_event_t *ev)
+{
+	const uint8_t first = ev->buffer[0];
+
+	if(first & 0x80)
+	{
+		_midi_handle(mixer, ev);
+	}
+	else
+	{
+		_osc_packet_handle(mixer, ev->buffer, ev->size, ev->time);
+	}
+}
+
+// apply OSC messages received by listener thread at start of current cycle,
+// a bounded number of them, so a flood of packets cannot stall the cycle
+static inline void
+_mixer_net_handle(mixer_app_t *mixer)
+{
+	mixer_net_t *net = mixer->net;
+
+	if(!net || mixer->frozen) // keep messages while gains are laid out anew
+		return;
+
+	const mixer_rec_t *rec;
+	size_t size;
+
+	for(unsigned n = 0;
+		(n < MIXER_NET_DRAIN_MAX) && (rec = varchunk_read_request(net->rx, &size));
+		n++)
+	{
+		const size_t len = size - sizeof(mixer_rec_t);
+		const int64_t frame = _mixer_sched_frame(mixer->sched, rec->timetag, 0);
+
+		if(frame <= 0) // due or late
+		{
+			LV2_OSC_Reader reader;
+			lv2_osc_reader_initialize(&reader, rec->body, len);
+
+			_osc_message_handle(mixer, &reader, 0);
+		}
+		else // dropped when too far ahead or scheduler is full, rather than applied early
+		{
+			_mixer_sched_push(mixer->sched, frame, rec->body, len);
+		}
+
+		varchunk_read_advance(net->rx);
+	}
+}
+
+static inline void
+_audio_mix_add(float *psource, const float *psink,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += psink[k];
+	}
+}
+
+static inline void
+_audio_mix_mul_add(float *psource, const float *psink, float gain,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += gain * psink[k];
+	}
+}
+
+static inline void
+_audio_mix_ramp_add(float *psource, const float *psink, float gain, float inc,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += (gain + inc*(k - from + 1)) * psink[k];
+	}
+}
+
+// variants of the above, also taking abs-max of sink while reading it anyway
+static inline float
+_audio_mix_add_peak(float *psource, const float *psink, float peak,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += psink[k];
+		peak = fmaxf(peak, fabsf(psink[k]));
+	}
+
+	return peak;
+}
+
+static inline float
+_audio_mix_mul_add_peak(float *psource, const float *psink, float gain, float peak,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += gain * psink[k];
+		peak = fmaxf(peak, fabsf(psink[k]));
+	}
+
+	return peak;
+}
+
+static inline float
+_audio_mix_ramp_add_peak(float *psource, const float *psink, float gain, float inc,
+	float peak, jack_nframes_t from, jack_nframes_t to)
+{
+	for(unsigned k = from; k < to; k++)
+	{
+		psource[k] += (gain + inc*(k - from + 1)) * psink[k];
+		peak = fmaxf(peak, fabsf(psink[k]));
+	}
+
+	return peak;
+}
+
+// abs-max of up to MONITOR_LANES buffers over a tile, with the monitors' kernel
+static inline void
+_audio_mixer_peaks(mixer_app_t *mixer, const float **pbufs, float **ppeaks,
+	unsigned n, jack_nframes_t from, jack_nframes_t to)
+{
+	const float *pspans [MONITOR_LANES];
+	monitor_stats_t stats;
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		const unsigned m = l < n ? l : 0; // unused lanes scan first buffer again
+
+		pspans[l] = &pbufs[m][from];
+		stats.min[l] = -*ppeaks[m];
+		stats.max[l] = *ppeaks[m];
+		stats.sum[l] = 0.f;
+	}
+
+	mixer->scan(pspans, to - from, &stats);
+
+	for(unsigned l = 0; l < n; l++)
+		*ppeaks[l] = _audio_monitor_stats_peak(&stats, l);
+}
+
+static inline jack_nframes_t
+_audio_mixer_tile_auto(unsigned nsinks)
+{
+	// fit one tile of the source and of all sinks into the L1 data cache
+	jack_nframes_t tile = MIXER_CACHE_SIZE / ((nsinks + 1) * sizeof(float));
+
+	tile -= tile % MIXER_TILE_ALIGN;
+
+	return tile < MIXER_TILE_MIN ? MIXER_TILE_MIN : tile;
+}
+
+static inline void
+_audio_mixer_cell(float *psource, const float *psink, const mixer_cell_t *cell,
+	jack_nframes_t from, jack_nframes_t to)
+{
+	const float gain = cell->gain;
+
+	if(gain != cell->target) // ramp
+	{
+		const jack_nframes_t mid = cell->from < from
+			? from
+			: (cell->from > to ? to : cell->from);
+		const float gain_mid = gain + cell->inc*(mid - cell->from);
+
+		_audio_mix_mul_add(psource, psink, gain, from, mid);
+		_audio_mix_ramp_add(psource, psink, gain_mid, cell->inc, mid, to);
+	}
+	else if(gain == 1.f) // just add
+	{
+		_audio_mix_add(psource, psink, from, to);
+	}
+	else // multiply-add
+	{
+		_audio_mix_mul_add(psource, psink, gain, from, to);
+	}
+}
+
+// as above, metering the sink on the way
+static inline float
+_audio_mixer_cell_peak(float *psource, const float *psink, const mixer_cell_t *cell,
+	float peak, jack_nframes_t from, jack_nframes_t to)
+{
+	const float gain = cell->gain;
+
+	if(gain != cell->target) // ramp
+	{
+		const jack_nframes_t mid = cell->from < from
+			? from
+			: (cell->from > to ? to : cell->from);
+		const float gain_mid = gain + cell->inc*(mid - cell->from);
+
+		peak = _audio_mix_mul_add_peak(psource, psink, gain, peak, from, mid);
+		return _audio_mix_ramp_add_peak(psource, psink, gain_mid, cell->inc, peak, mid, to);
+	}
+	else if(gain == 1.f) // just add
+	{
+		return _audio_mix_add_peak(psource, psink, peak, from, to);
+	}
+
+	// multiply-add
+	return _audio_mix_mul_add_peak(psource, psink, gain, peak, from, to);
+}
+
+static inline void
+_audio_mixer_process_internal(mixer_app_t *mixer, unsigned from, unsigned to,
+	unsigned sfrom, unsigned sto, jack_nframes_t nframes)
+{
+	float **psources = mixer->psources;
+	const float **psinks = mixer->psinks;
+	const jack_nframes_t fade = mixer->fade;
+	const atomic_int *live = mixer->frozen
+		? NULL
+		: _mixer_shm_live(mixer->shm);
+	float *peaks = mixer->metered
+		? mixer->peaks
+		: NULL;
+	float *speaks = peaks ? &peaks[mixer->nsinks] : NULL;
+	unsigned *meters = mixer->meters;
+
+	if(peaks)
+	{
+		for(unsigned i = sfrom; i < sto; i++)
+		{
+			peaks[i] = 0.f;
+			meters[i] = mixer->nsources; // none yet
+		}
+		for(unsigned j = from; j < to; j++)
+			speaks[j] = 0.f;
+	}
+
+	// update gain targets and collect cells to be mixed
+	for(unsigned j = from; j < to; j++)
+	{
+		mixer->nactive[j] = 0;
+
+		for(unsigned i = 0; i < mixer->nsinks; i++)
+		{
+			mixer_cell_t *cell = _mixer_cell(mixer, j, i);
+			const int32_t mBFS = live
+				? atomic_load_explicit(&live[j*mixer->nsinks + i], memory_order_relaxed)
+				: cell->mBFS;
+
+			if(mBFS != cell->mBFS) // gain has changed, ramp to new target
+			{
+				cell->mBFS = mBFS;
+				cell->final = _mixer_gain(mixer, mBFS);
+
+				if(!cell->dirty) // changed via UI, ramp over whole cycle
+				{
+					cell->from = 0;
+				}
+			}
+
+			// while crossfading to a scene, only cover this cycle's share of the way
+			cell->target = ( (fade > nframes) && !cell->dirty )
+				? cell->gain + (cell->final - cell->gain) * nframes / fade
+				: cell->final;
+
+			cell->inc = (cell->target - cell->gain) / (nframes - cell->from);
+			cell->dirty = false;
+
+			if( (cell->gain != 0.f) || (cell->target != 0.f) )
+			{
+				_mixer_active(mixer, j)[mixer->nactive[j]++] = i;
+
+				// first cell of this thread to read one of its sinks meters it
+				if(peaks && (i >= sfrom) && (i < sto) && (meters[i] == mixer->nsources))
+					meters[i] = j;
+			}
+			// else connection not to be mixed
+		}
+
+		// clear
+		for(unsigned k = 0; k < nframes; k++)
+		{
+			psources[j][k] = 0.f;
+		}
+	}
+
+	// mix in frame tiles, so that sink buffers stay cached across sources
+	const jack_nframes_t tile = (mixer->tile && (mixer->tile < nframes))
+		? mixer->tile
+		: nframes;
+
+	for(jack_nframes_t k0 = 0; k0 < nframes; k0 += tile)
+	{
+		const jack_nframes_t k1 = (k0 + tile < nframes)
+			? k0 + tile
+			: nframes;
+
+		for(unsigned j = from; j < to; j++)
+		{
+			for(unsigned a = 0; a < mixer->nactive[j]; a++)
+			{
+				const unsigned i = _mixer_active(mixer, j)[a];
+				const mixer_cell_t *cell = _mixer_cell(mixer, j, i);
+
+				// range is checked first, other threads meter the other sinks
+				if(peaks && (i >= sfrom) && (i < sto) && (meters[i] == j))
+					peaks[i] = _audio_mixer_cell_peak(psources[j], psinks[i], cell, peaks[i], k0, k1);
+				else
+					_audio_mixer_cell(psources[j], psinks[i], cell, k0, k1);
+			}
+		}
+
+		// meter while tiles are cached anyway, each thread its share of sinks
+		if(peaks)
+		{
+			const float *pbufs [MONITOR_LANES];
+			float *ppeaks [MONITOR_LANES];
+			unsigned n = 0;
+
+			for(unsigned i = sfrom; i < sto; i++)
+			{
+				if(meters[i] != mixer->nsources) // metered while mixing
+					continue;
+
+				pbufs[n] = psinks[i];
+				ppeaks[n] = &peaks[i];
+
+				if(++n == MONITOR_LANES)
+				{
+					_audio_mixer_peaks(mixer, pbufs, ppeaks, n, k0, k1);
+					n = 0;
+				}
+			}
+
+			for(unsigned j = from; j < to; j++)
+			{
+				pbufs[n] = psources[j];
+				ppeaks[n] = &speaks[j];
+
+				if(++n == MONITOR_LANES)
+				{
+					_audio_mixer_peaks(mixer, pbufs, ppeaks, n, k0, k1);
+					n = 0;
+				}
+			}
+
+			if(n > 0)
+				_audio_mixer_peaks(mixer, pbufs, ppeaks, n, k0, k1);
+		}
+	}
+
+	// hold peaks until UI takes them
+	if(peaks && !mixer->frozen)
+	{
+		atomic_int *held = _mixer_shm_peaks(mixer->shm);
+
+		for(unsigned i = sfrom; i < sto; i++)
+			_monitor_hold(&held[i], _monitor_peak_to_held(peaks[i]));
+		for(unsigned j = from; j < to; j++)
+			_monitor_hold(&held[mixer->nsinks + j], _monitor_peak_to_held(speaks[j]));
+	}
+
+	// ramps have reached their targets
+	for(unsigned j = from; j < to; j++)
+	{
+		for(unsigned a = 0; a < mixer->nactive[j]; a++)
+		{
+			mixer_cell_t *cell = _mixer_cell(mixer, j, _mixer_active(mixer, j)[a]);
+
+			cell->gain = cell->target;
+		}
+	}
+}
+
+static void *
+_audio_mixer_worker(void *data)
+{
+	mixer_worker_t *worker = data;
+	mixer_app_t *mixer = worker->mixer;
+
+	while(true)
+	{
+		sem_wait(&worker->start);
+
+		if(atomic_load_explicit(&mixer->quit, memory_order_acquire))
+			break;
+
+		_audio_mixer_process_internal(mixer, worker->from, worker->to,
+			worker->sfrom, worker->sto, mixer->nframes);
+
+		sem_post(&mixer->done);
+	}
+
+	return NULL;
+}
+
+static int
+_audio_mixer_workers_start(mixer_app_t *mixer, unsigned nthreads)
+{
+	const bool realtime = jack_is_realtime(mixer->client);
+	const int priority = realtime
+		? jack_client_real_time_priority(mixer->client)
+		: 0;
+
+	atomic_init(&mixer->quit, false);
+	mixer->nworkers = 0;
+
+	if(nthreads <= 1) // mix in process thread only
+		return 0;
+
+	if(nthreads > MIXER_THREADS_MAX)
+		nthreads = MIXER_THREADS_MAX;
+
+	if(sem_init(&mixer->done, 0, 0) == -1)
+		return -1;
+
+	for(unsigned w = 0; w < nthreads - 1; w++)
+	{
+		mixer_worker_t *worker = &mixer->workers[w];
+
+		worker->mixer = mixer;
+
+		if(sem_init(&worker->start, 0, 0) == -1)
+			break;
+
+		if(jack_client_create_thread(mixer->client, &worker->thread, priority,
+			realtime, _audio_mixer_worker, worker) != 0)
+		{
+			sem_destroy(&worker->start);
+			break;
+		}
+
+		mixer->nworkers++;
+	}
+
+	if(mixer->nworkers == 0)
+	{
+		sem_destroy(&mixer->done);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_audio_mixer_workers_stop(mixer_app_t *mixer)
+{
+	if(mixer->nworkers == 0)
+		return;
+
+	atomic_store_explicit(&mixer->quit, true, memory_order_release);
+
+	for(unsigned w = 0; w < mixer->nworkers; w++)
+	{
+		mixer_worker_t *worker = &mixer->workers[w];
+
+		sem_post(&worker->start);
+		jack_client_stop_thread(mixer->client, worker->thread);
+		sem_destroy(&worker->start);
+	}
+
+	mixer->nworkers = 0;
+	sem_destroy(&mixer->done);
+}
+
+static void
+_mixer_net_sleep(unsigned ms)
+{
+	const struct timespec ts = {
+		.tv_sec = ms / 1000,
+		.tv_nsec = (ms % 1000) * 1000000
+	};
+
+	nanosleep(&ts, NULL);
+}
+
+// waits while ring is full, leaving further packets in the socket meanwhile
+static void
+_mixer_net_push(mixer_net_t *net, const uint8_t *body, size_t size,
+	uint64_t timetag)
+{
+	const size_t len = sizeof(mixer_rec_t) + size;
+	mixer_rec_t *rec;
+
+	while( !(rec = varchunk_write_request(net->rx, len)) )
+	{
+		if(atomic_load_explicit(&net->quit, memory_order_acquire))
+			return;
+
+		_mixer_net_sleep(MIXER_NET_STALL);
+	}
+
+	rec->timetag = timetag;
+	memcpy(rec->body, body, size);
+	varchunk_write_advance(net->rx, len);
+}
+
+// check and unbundle packet, so process thread only gets messages it understands
+static void
+_mixer_net_packet(mixer_net_t *net, const uint8_t *body, size_t size,
+	uint64_t timetag)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		{
+			// nested bundles are not applied before their enclosing one
+			_mixer_net_packet(net, itm->body, itm->size,
+				itm->timetag > timetag ? itm->timetag : timetag);
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader) && _osc_message_check(body, size))
+	{
+		_mixer_net_push(net, body, size, timetag);
+	}
+}
+
+static void *
+_mixer_net_write_req(void *data, size_t minimum, size_t *maximum)
+{
+	mixer_net_t *net = data;
+
+	if(minimum > sizeof(net->buf))
+		return NULL;
+
+	if(maximum)
+		*maximum = sizeof(net->buf);
+
+	return net->buf;
+}
+
+static void
+_mixer_net_write_adv(void *data, size_t written)
+{
+	mixer_net_t *net = data;
+
+	_mixer_net_packet(net, net->buf, written, 1ULL); // immediately
+}
+
+static const void *
+_mixer_net_read_req(void *data, size_t *toread)
+{
+	return NULL; // listen only
+}
+
+static void
+_mixer_net_read_adv(void *data)
+{
+	// nothing to send
+}
+
+static const LV2_OSC_Driver mixer_net_driver = {
+	.write_req = _mixer_net_write_req,
+	.write_adv = _mixer_net_write_adv,
+	.read_req = _mixer_net_read_req,
+	.read_adv = _mixer_net_read_adv
+};
+
+// returns true if socket has become readable
+static bool
+_mixer_net_poll(mixer_net_t *net)
+{
+	LV2_OSC_Stream *stream = &net->stream;
+	struct pollfd pfd = {
+		.fd = (stream->server && stream->connected) ? stream->fd : stream->sock,
+		.events = POLLIN
+	};
+
+	return poll(&pfd, 1, MIXER_NET_POLL) > 0;
+}
+
+static void *
+_mixer_net_listener(void *data)
+{
+	mixer_net_t *net = data;
+	int err = 0;
+
+	while(!atomic_load_explicit(&net->quit, memory_order_acquire))
+	{
+		// receive and unframe packets, pass on their checked messages to ring
+		const LV2_OSC_Enum ev = lv2_osc_stream_run(&net->stream);
+		const int nerr = ev & LV2_OSC_ERR;
+
+		if(nerr && (nerr != err)) // report only once
+		{
+			fprintf(stderr, "OSC listener: %s\n", strerror(nerr));
+		}
+		err = nerr;
+
+		if(ev & LV2_OSC_RECV)
+			continue;
+
+		if(err) // e.g. peer not reachable, retry later
+		{
+			_mixer_net_sleep(MIXER_NET_POLL);
+		}
+
+		_mixer_net_poll(net);
+	}
+
+	return NULL;
+}
+
+static int
+_mixer_net_start(mixer_app_t *mixer, const char *url)
+{
+	mixer_net_t *net = calloc(1, sizeof(mixer_net_t));
+	if(!net)
+		return -1;
+
+	if(!(net->rx = varchunk_new(MIXER_NET_SIZE, true)))
+	{
+		free(net);
+		return -1;
+	}
+
+	const LV2_OSC_Enum ev = lv2_osc_stream_init(&net->stream, url,
+		&mixer_net_driver, net);
+	net->stream.fd = -1; // only set by accept, keep deinit from closing stdin
+
+	if(ev & LV2_OSC_ERR)
+	{
+		fprintf(stderr, "failed to listen on %s: %s\n", url,
+			strerror(ev & LV2_OSC_ERR));
+		lv2_osc_stream_deinit(&net->stream);
+		varchunk_free(net->rx);
+		free(net);
+		return -1;
+	}
+
+	atomic_init(&net->quit, false);
+
+	if(pthread_create(&net->thread, NULL, _mixer_net_listener, net) != 0)
+	{
+		lv2_osc_stream_deinit(&net->stream);
+		varchunk_free(net->rx);
+		free(net);
+		return -1;
+	}
+
+	mixer->net = net;
+
+	return 0;
+}
+
+// call once process callback does not run any more
+static void
+_mixer_net_stop(mixer_app_t *mixer)
+{
+	mixer_net_t *net = mixer->net;
+
+	if(!net)
+		return;
+
+	atomic_store_explicit(&net->quit, true, memory_order_release);
+	pthread_join(net->thread, NULL);
+
+	lv2_osc_stream_deinit(&net->stream);
+	varchunk_free(net->rx);
+	free(net);
+	mixer->net = NULL;
+}
+
+static int
+_audio_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	mixer_app_t *mixer = arg;
+	mixer_shm_t *shm = mixer->shm;
+
+	if(  atomic_load_explicit(&closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	void *pautom;
+
+	_mixer_sync_handle(mixer);
+	_mixer_bank_handle(mixer);
+	_mixer_sched_cycle(mixer, nframes);
+	_mixer_net_handle(mixer);
+
+	for(unsigned i = 0; i < mixer->nsinks; i++)
+	{
+		jack_port_t *jsink = mixer->jsinks[i];
+		mixer->psinks[i] = jack_port_get_buffer(jsink, nframes);
+	}
+
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		jack_port_t *jsource = mixer->jsources[j];
+		mixer->psources[j] = jack_port_get_buffer(jsource, nframes);
+	}
+
+	// automation events only set new gain targets at their frame offsets
+	pautom = jack_port_get_buffer(mixer->jautom, nframes);
+	const unsigned count = jack_midi_get_event_count(pautom);
+
+	for(unsigned p = 0; p < count; p++)
+	{
+			jack_midi_event_t ev;
+			jack_midi_event_get(&ev, pautom, p);
+
+			_mixer_sched_apply(mixer, ev.time + 1);
+			_autom_handle(mixer, &ev);
+	}
+
+	_mixer_sched_apply(mixer, nframes);
+
+	// partition source and sink ports across workers and this thread
+	const unsigned nthreads = mixer->nworkers + 1;
+	const unsigned nsources = mixer->nsources;
+	const unsigned nsinks = mixer->nsinks;
+
+	mixer->nframes = nframes;
+
+	for(unsigned w = 0; w < mixer->nworkers; w++)
+	{
+		mixer_worker_t *worker = &mixer->workers[w];
+
+		worker->from = nsources * (w + 1) / nthreads;
+		worker->to = nsources * (w + 2) / nthreads;
+		worker->sfrom = nsinks * (w + 1) / nthreads;
+		worker->sto = nsinks * (w + 2) / nthreads;
+
+		sem_post(&worker->start);
+	}
+
+	// mix whole cycle in one pass with per-cell linear gain ramps
+	_audio_mixer_process_internal(mixer, 0, nsources / nthreads,
+		0, nsinks / nthreads, nframes);
+
+	// wait for workers to finish before returning to JACK
+	for(unsigned w = 0; w < mixer->nworkers; w++)
+	{
+		sem_wait(&mixer->done);
+	}
+
+	mixer->fade = (mixer->fade > nframes)
+		? mixer->fade - nframes
+		: 0;
+
+	return 0;
+}
+
+static inline bool
+_midi_head_before(const mixer_head_t *a, const mixer_head_t *b)
+{
+	if(a->ev.time != b->ev.time)
+		return a->ev.time < b->ev.time;
+
+	return a->i > b->i; // automation and higher sink ports first on same frame
+}
+
+static inline void
+_midi_heap_sift_down(mixer_head_t *heads, unsigned nheads, unsigned p)
+{
+	const mixer_head_t head = heads[p];
+
+	while(true)
+	{
+		unsigned c = 2*p + 1;
+
+		if(c >= nheads) // no children
+			break;
+
+		if( (c + 1 < nheads) && _midi_head_before(&heads[c + 1], &heads[c]) )
+			c += 1; // right child is earlier
+
+		if(!_midi_head_before(&heads[c], &head))
+			break;
+
+		heads[p] = heads[c];
+		p = c;
+	}
+
+	heads[p] = head;
+}
+
+static int
+_midi_mixer_process(jack_nframes_t nframes, void *arg)
+{
+	mixer_app_t *mixer = arg;
+	mixer_shm_t *shm = mixer->shm;
+
+	if(  atomic_load_explicit(&closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	float **psources = mixer->psources;
+	mixer_head_t *heads = mixer->heads;
+	unsigned nheads = 0;
+
+	_mixer_sync_handle(mixer);
+	_mixer_bank_handle(mixer); // scenes are recalled without crossfade
+	_mixer_sched_cycle(mixer, nframes);
+	_mixer_net_handle(mixer);
+
+	// pick up gain changes from the UI
+	if(!mixer->frozen)
+		_midi_mixer_refresh(mixer, false);
+
+	// cache first event of every sink port with pending events
+	for(unsigned i = 0; i < mixer->nsinks + 1; i++)
+	{
+		jack_port_t *jsink = (i == mixer->nsinks)
+			? mixer->jautom
+			: mixer->jsinks[i];
+		mixer_head_t *head = &heads[nheads];
+
+		head->buf = jack_port_get_buffer(jsink, nframes);
+		head->count = jack_midi_get_event_count(head->buf);
+		head->pos = 0;
+		head->i = i;
+
+		if( (head->count > 0)
+			&& (jack_midi_event_get(&head->ev, head->buf, head->pos) == 0) )
+		{
+			nheads++;
+		}
+	}
+
+	for(unsigned p = nheads/2; p-- > 0; )
+	{
+		_midi_heap_sift_down(heads, nheads, p);
+	}
+
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		jack_port_t *jsource = mixer->jsources[j];
+		psources[j] = jack_port_get_buffer(jsource, nframes);
+
+		// clear
+		jack_midi_clear_buffer(psources[j]);
+	}
+
+	// k-way merge of sink ports, earliest cached event is always on top
+	while(nheads > 0)
+	{
+		mixer_head_t *head = &heads[0];
+		const jack_midi_event_t *ev = &head->ev;
+		const unsigned I = head->i;
+
+		// scheduled gain changes precede events of same frame
+		_mixer_sched_apply(mixer, ev->time + 1);
+
+		if(I == mixer->nsinks) // automation port
+		{
+			_autom_handle(mixer, &head->ev);
+		}
+		else
+		{
+			const uint8_t cmd = ev->buffer[0] & 0xf0;
+			const bool is_note = (ev->size == 3) && ( (cmd == 0x90) || (cmd == 0x80) );
+			const uint8_t vel = ev->buffer[2] & 0x7f;
+
+			for(unsigned d = 0; d < mixer->ndests[I]; d++)
+			{
+				const unsigned j = _mixer_dests(mixer, I)[d];
+
+				uint8_t *msg = jack_midi_event_reserve(psources[j], ev->time, ev->size);
+				if(!msg)
+					continue;
+
+				memcpy(msg, ev->buffer, ev->size);
+
+				if(is_note) // scale velocity of noteOn or noteOff
+				{
+					msg[2] = _mixer_vels(mixer, j, I)[vel];
+				}
+			}
+		}
+
+		// advance event pointer from this sink or drop it from the heap
+		if(  (++head->pos >= head->count)
+			|| (jack_midi_event_get(&head->ev, head->buf, head->pos) != 0) )
+		{
+			heads[0] = heads[--nheads];
+		}
+
+		_midi_heap_sift_down(heads, nheads, 0);
+	}
+
+	_mixer_sched_apply(mixer, nframes);
+
+	return 0;
+}
+
+static inline const char *
+_mixer_group(mixer_app_t *mixer)
+{
+	return mixer->hosted ? mixer->name : NULL;
+}
+
+static jack_port_t *
+_mixer_sink_register(mixer_app_t *mixer, unsigned i)
+{
+	char buf [32];
+	snprintf(buf, 32, "sink_%02u", i + 1);
+
+	jack_port_t *jsink = _group_port_register(mixer->client, _mixer_group(mixer), buf,
+		mixer->type == TYPE_MIDI ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE,
+		JackPortIsInput);
+	if(!jsink)
+		return NULL;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(jsink);
+
+	snprintf(buf, 32, "%u", i);
+	jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+	if(mixer->type == TYPE_MIDI)
+		jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
+	else if(mixer->type == TYPE_CV)
+		jack_set_property(mixer->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+	snprintf(buf, 32, "Sink %u", i + 1);
+	jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+	return jsink;
+}
+
+static jack_port_t *
+_mixer_source_register(mixer_app_t *mixer, unsigned j)
+{
+	char buf [32];
+	snprintf(buf, 32, "source_%02u", j + 1);
+
+	jack_port_t *jsource = _group_port_register(mixer->client, _mixer_group(mixer), buf,
+		mixer->type == TYPE_MIDI ? JACK_DEFAULT_MIDI_TYPE : JACK_DEFAULT_AUDIO_TYPE,
+		JackPortIsOutput);
+	if(!jsource)
+		return NULL;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(jsource);
+
+	snprintf(buf, 32, "%u", j);
+	jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+	if(mixer->type == TYPE_MIDI)
+		jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
+	else if(mixer->type == TYPE_CV)
+		jack_set_property(mixer->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+	snprintf(buf, 32, "Source %u", j + 1);
+	jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+	return jsource;
+}
+
+static void
+_mixer_port_unregister(mixer_app_t *mixer, jack_port_t *port)
+{
+	if(!port)
+		return;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(port);
+	jack_remove_properties(mixer->client, uuid);
+#endif
+	jack_port_unregister(mixer->client, port);
+}
+
+static void
+_mixer_autom_order(mixer_app_t *mixer)
+{
+#ifdef JACK_HAS_METADATA_API
+	char buf [32];
+	jack_uuid_t uuid = jack_port_uuid(mixer->jautom);
+
+	snprintf(buf, 32, "%u", mixer->nsinks);
+	jack_set_property(mixer->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+#else
+	(void)mixer;
+#endif
+}
+
+static void
+_mixer_cells_init(mixer_app_t *mixer)
+{
+	// take over gains from shm, MIDI mixers need their lookup tables, too
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		for(unsigned i = 0; i < mixer->nsinks; i++)
+		{
+			mixer_cell_t *cell = _mixer_cell(mixer, j, i);
+
+			cell->mBFS = atomic_load_explicit(_mixer_shm_gain(mixer->shm, j, i),
+				memory_order_relaxed);
+			cell->gain = _mixer_gain(mixer, cell->mBFS);
+			cell->target = cell->gain;
+			cell->final = cell->gain;
+		}
+	}
+
+	if(mixer->type == TYPE_MIDI)
+	{
+		_midi_mixer_refresh(mixer, true);
+	}
+}
+
+static int
+_mixer_resize(mixer_app_t *mixer, mixer_app_t *next,
+	unsigned nsinks, unsigned nsources, int tile)
+{
+	const unsigned osinks = mixer->nsinks;
+	const unsigned osources = mixer->nsources;
+	mixer_shm_t *oshm = mixer->shm;
+
+	if( (nsinks == osinks) && (nsources == osources) )
+		return 0;
+
+	// segment only ever grows, so that current mappings of it stay valid
+	size_t size = _mixer_shm_size(nsinks, nsources);
+	if(size < mixer->shm_size)
+		size = mixer->shm_size;
+
+	if( (size > mixer->shm_size) && (ftruncate(mixer->fd, size) == -1) )
+		return -1;
+
+	// scenes are laid out anew in place, so stash them with their old stride
+	int32_t *scenes = malloc(MIXER_SCENE_MAX*nsources*nsinks*sizeof(int32_t));
+	if(!scenes)
+		return -1;
+
+	mixer_shm_t *shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mixer->fd, 0);
+	if(shm == MAP_FAILED)
+	{
+		free(scenes);
+		return -1;
+	}
+
+	next->client = mixer->client;
+	next->type = mixer->type;
+	next->metered = mixer->metered;
+	next->tile = (tile < 0)
+		? _audio_mixer_tile_auto(nsinks)
+		: (jack_nframes_t)tile;
+	next->shm = shm;
+
+	if(_mixer_app_alloc(next, nsinks, nsources) == -1)
+	{
+		free(scenes);
+		munmap(shm, size);
+		return -1;
+	}
+
+	// keep existing ports and register missing ones while still running
+	bool failed = false;
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		next->jsinks[i] = (i < osinks)
+			? mixer->jsinks[i]
+			: _mixer_sink_register(mixer, i);
+
+		failed = failed || !next->jsinks[i];
+	}
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		next->jsources[j] = (j < osources)
+			? mixer->jsources[j]
+			: _mixer_source_register(mixer, j);
+
+		failed = failed || !next->jsources[j];
+	}
+
+	// keep UI and RT thread off the gains while they are laid out anew
+	atomic_fetch_add_explicit(&oshm->gen, 1, memory_order_acq_rel);
+
+	if(failed
+		|| (_shm_sync(&mixer->sync, &oshm->closing, SYNC_FREEZE, SYNC_FROZEN, 1000) == -1) )
+	{
+		atomic_store_explicit(&mixer->sync, SYNC_NONE, memory_order_release);
+		atomic_fetch_add_explicit(&oshm->gen, 1, memory_order_acq_rel);
+
+		for(unsigned i = osinks; i < nsinks; i++)
+			_mixer_port_unregister(mixer, next->jsinks[i]);
+		for(unsigned j = osources; j < nsources; j++)
+			_mixer_port_unregister(mixer, next->jsources[j]);
+
+		_mixer_app_free(next);
+		free(scenes);
+		munmap(shm, size);
+		return -1;
+	}
+
+	// read current gains with old stride before writing them with new one
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			_mixer_cell(next, j, i)->mBFS = ( (j < osources) && (i < osinks) )
+				? atomic_load_explicit(_mixer_shm_gain(oshm, j, i), memory_order_relaxed)
+				: _mixer_default(next, j, i);
+		}
+	}
+
+	for(unsigned s = 0; s < MIXER_SCENE_MAX; s++)
+	{
+		const atomic_int *scene = _mixer_shm_scene(oshm, s);
+
+		for(unsigned j = 0; j < nsources; j++)
+		{
+			for(unsigned i = 0; i < nsinks; i++)
+			{
+				scenes[(s*nsources + j)*nsinks + i] = ( (j < osources) && (i < osinks) )
+					? atomic_load_explicit(&scene[j*osinks + i], memory_order_relaxed)
+					: _mixer_default(next, j, i);
+			}
+		}
+	}
+
+	_shm_header_init(&shm->header, size, next->type, nsinks, nsources);
+
+	// RT thread is frozen, so restart from first gain matrix without a pending flip
+	atomic_store_explicit(&shm->bank, 0, memory_order_relaxed);
+	atomic_store_explicit(&shm->flip, 0, memory_order_relaxed);
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			atomic_store_explicit(_mixer_shm_gain(shm, j, i),
+				_mixer_cell(next, j, i)->mBFS, memory_order_relaxed);
+		}
+	}
+
+	for(unsigned k = 0; k < nsinks + nsources; k++)
+	{
+		atomic_store_explicit(&_mixer_shm_peaks(shm)[k], 0, memory_order_relaxed);
+	}
+
+	for(unsigned s = 0; s < MIXER_SCENE_MAX; s++)
+	{
+		atomic_int *scene = _mixer_shm_scene(shm, s);
+
+		for(unsigned k = 0; k < nsources*nsinks; k++)
+		{
+			atomic_store_explicit(&scene[k], scenes[s*nsources*nsinks + k], memory_order_relaxed);
+		}
+	}
+
+	free(scenes);
+
+	_mixer_cells_init(next);
+
+	// RT thread swaps in new state at its next cycle boundary
+	mixer->next = next;
+	if(_shm_sync(&mixer->sync, &oshm->closing, SYNC_SWAP, SYNC_NONE, 0) == -1)
+	{
+		// closing, RT thread will not run again, new ports go with the client
+		_mixer_app_free(next);
+		munmap(shm, size);
+		return -1;
+	}
+
+	atomic_fetch_add_explicit(&shm->gen, 1, memory_order_acq_rel);
+
+	// next now holds the old state, drop what is no longer mixed
+	for(unsigned i = nsinks; i < osinks; i++)
+		_mixer_port_unregister(mixer, next->jsinks[i]);
+	for(unsigned j = nsources; j < osources; j++)
+		_mixer_port_unregister(mixer, next->jsources[j]);
+
+	_mixer_autom_order(mixer);
+
+	munmap(next->shm, mixer->shm_size);
+	_mixer_app_free(next);
+	mixer->shm_size = size;
+
+	return 0;
+}
+
+static int
+_mixer_ports_register(mixer_app_t *mixer)
+{
+	bool failed = false;
+
+	for(unsigned i = 0; i < mixer->nsinks; i++)
+	{
+		mixer->jsinks[i] = _mixer_sink_register(mixer, i);
+		failed = failed || !mixer->jsinks[i];
+	}
+
+	mixer->jautom = _group_port_register(mixer->client, _mixer_group(mixer),
+		"automation", JACK_DEFAULT_MIDI_TYPE, JackPortIsInput);
+	if(mixer->jautom)
+	{
+#ifdef JACK_HAS_METADATA_API
+		jack_uuid_t uuid = jack_port_uuid(mixer->jautom);
+
+		jack_set_property(mixer->client, uuid, JACKEY_EVENT_TYPES, "MIDI,OSC", "text/plain");
+
+		jack_set_property(mixer->client, uuid, JACK_METADATA_PRETTY_NAME, "Automation", "text/plain");
+#endif
+
+		_mixer_autom_order(mixer);
+	}
+	failed = failed || !mixer->jautom;
+
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		mixer->jsources[j] = _mixer_source_register(mixer, j);
+		failed = failed || !mixer->jsources[j];
+	}
+
+	return failed ? -1 : 0;
+}
+
+static void
+_mixer_ports_unregister(mixer_app_t *mixer)
+{
+	for(unsigned i = 0; i < mixer->nsinks; i++)
+	{
+		_mixer_port_unregister(mixer, mixer->jsinks[i]);
+	}
+
+	_mixer_port_unregister(mixer, mixer->jautom);
+
+	for(unsigned j = 0; j < mixer->nsources; j++)
+	{
+		_mixer_port_unregister(mixer, mixer->jsources[j]);
+	}
+}
+
+static int
+_mixer_shm_open(mixer_app_t *mixer, int oflag)
+{
+	const unsigned nsinks = mixer->nsinks;
+	const unsigned nsources = mixer->nsources;
+
+	mixer->shm_size = _mixer_shm_size(nsinks, nsources);
+	mixer->fd = shm_open(mixer->name, O_RDWR | O_CREAT | oflag, S_IRUSR | S_IWUSR);
+	if(mixer->fd == -1)
+		return -1;
+
+	if(  (ftruncate(mixer->fd, mixer->shm_size) == -1)
+		|| ((mixer->shm = mmap(NULL, mixer->shm_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, mixer->fd, 0)) == MAP_FAILED) )
+	{
+		mixer->shm = NULL;
+		close(mixer->fd);
+		shm_unlink(mixer->name);
+		return -1;
+	}
+
+	_shm_header_init(&mixer->shm->header, mixer->shm_size, mixer->type, nsinks, nsources);
+
+	atomic_init(&mixer->shm->closing, false);
+	atomic_init(&mixer->shm->gen, 0);
+	atomic_init(&mixer->shm->resize, 0);
+	atomic_init(&mixer->shm->scene, 0);
+	atomic_init(&mixer->shm->stored, 0);
+	atomic_init(&mixer->shm->current, 0);
+	atomic_init(&mixer->shm->bank, 0);
+	atomic_init(&mixer->shm->flip, 0);
+	atomic_init(&mixer->shm->fade, 0);
+	atomic_init(&mixer->sync, SYNC_NONE);
+	mixer->shm->metered = mixer->metered;
+
+	for(unsigned k = 0; k < nsinks + nsources; k++)
+	{
+		atomic_init(&_mixer_shm_peaks(mixer->shm)[k], 0);
+	}
+
+	for(unsigned j = 0; j < nsources; j++)
+	{
+		for(unsigned i = 0; i < nsinks; i++)
+		{
+			atomic_init(_mixer_shm_gain(mixer->shm, j, i), _mixer_default(mixer, j, i));
+		}
+	}
+
+	_mixer_cells_init(mixer);
+
+	if(sem_init(&mixer->shm->done, 1, 0) == -1)
+	{
+		munmap(mixer->shm, mixer->shm_size);
+		mixer->shm = NULL;
+		close(mixer->fd);
+		shm_unlink(mixer->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_mixer_shm_close(mixer_app_t *mixer)
+{
+	sem_destroy(&mixer->shm->done);
+	munmap(mixer->shm, mixer->shm_size);
+	mixer->shm = NULL;
+
+	close(mixer->fd);
+	shm_unlink(mixer->name);
+}
+
+static int
+_mixer_scene(mixer_app_t *mixer, uint32_t scene)
+{
+	mixer_shm_t *shm = mixer->shm;
+	const uint32_t slot = (scene & (MIXER_SCENE_STORE - 1)) - 1;
+	const uint32_t n = mixer->nsources*mixer->nsinks;
+
+	if(slot >= MIXER_SCENE_MAX)
+		return -1;
+
+	atomic_int *gains = _mixer_shm_scene(shm, slot);
+	const uint32_t bank = atomic_load_explicit(&shm->bank, memory_order_acquire);
+
+	if(scene & MIXER_SCENE_STORE) // snapshot of live gain matrix
+	{
+		const atomic_int *live = _mixer_shm_bank(shm, bank);
+
+		for(uint32_t k = 0; k < n; k++)
+		{
+			atomic_store_explicit(&gains[k],
+				atomic_load_explicit(&live[k], memory_order_relaxed), memory_order_relaxed);
+		}
+
+		atomic_fetch_or_explicit(&shm->stored, 1 << slot, memory_order_release);
+		atomic_store_explicit(&shm->current, slot + 1, memory_order_release);
+
+		return 0;
+	}
+
+	if(!(atomic_load_explicit(&shm->stored, memory_order_acquire) & (1 << slot)))
+		return -1; // nothing to recall
+
+	// prepare idle gain matrix, RT thread flips to it at its next cycle boundary
+	atomic_int *idle = _mixer_shm_bank(shm, bank ^ 1);
+
+	for(uint32_t k = 0; k < n; k++)
+	{
+		atomic_store_explicit(&idle[k],
+			atomic_load_explicit(&gains[k], memory_order_relaxed), memory_order_relaxed);
+	}
+
+	const uint64_t fade = (uint64_t)(scene >> 16) * jack_get_sample_rate(mixer->client) / 1000;
+
+	atomic_store_explicit(&shm->fade, fade, memory_order_relaxed);
+	atomic_store_explicit(&shm->flip, 1, memory_order_release);
+	atomic_store_explicit(&shm->current, slot + 1, memory_order_release);
+
+	for(unsigned ms = 0; ms < 1000; ms++)
+	{
+		if(!atomic_load_explicit(&shm->flip, memory_order_acquire))
+			return 0;
+
+		if(atomic_load_explicit(&shm->closing, memory_order_relaxed))
+			break;
+
+		usleep(1000);
+	}
+
+	// take back flip unless RT thread has picked it up in the meantime
+	uint32_t expected = 1;
+	return atomic_compare_exchange_strong_explicit(&shm->flip, &expected, 0,
+		memory_order_acq_rel, memory_order_acquire) ? -1 : 0;
+}
+
+static void
+_mixer_run(mixer_app_t *mixer, mixer_app_t *next, int tile)
+{
+	while(true)
+	{
+		sem_wait(&mixer->shm->done);
+
+		if(atomic_load_explicit(&mixer->shm->closing, memory_order_relaxed))
+			break;
+
+		const uint32_t scene = atomic_exchange_explicit(&mixer->shm->scene, 0,
+			memory_order_acquire);
+		if(scene && (_mixer_scene(mixer, scene) == -1) )
+		{
+			fprintf(stderr, "failed to handle scene %u\n", scene & (MIXER_SCENE_STORE - 1));
+		}
+
+		const uint32_t resize = atomic_exchange_explicit(&mixer->shm->resize, 0,
+			memory_order_acquire);
+		if(!resize) // request already handled
+			continue;
+
+		if(_mixer_resize(mixer, next, resize >> 16, resize & 0xffff, tile) == -1)
+		{
+			fprintf(stderr, "failed to resize mixer\n");
+		}
+	}
+
+	atomic_store_explicit(&mixer->shm->closing, true, memory_order_relaxed);
+}
+
+#endif // _PATCHMATRIX_MIXER_H
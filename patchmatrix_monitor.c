@@ -15,32 +15,7 @@
  * http://www.perlfoundation.org/artistic_license_2_0.
  */
 
-#include <sys/mman.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-
-#include <patchmatrix.h>
-
-typedef struct _monitor_app_t monitor_app_t;
-
-struct _monitor_app_t {
-	jack_client_t *client;
-	jack_port_t *jsinks [PORT_MAX];
-	float sample_rate_1;
-	union {
-		struct {
-			float dBFSs [PORT_MAX];
-		} audio;
-		struct {
-			float vels [PORT_MAX];
-		} midi;
-	};
-	port_type_t type;
-
-	monitor_shm_t *shm;	
-};
-
-static atomic_bool closed = ATOMIC_VAR_INIT(false);
+#include <patchmatrix_monitor.h>
 
 static void
 _close(monitor_shm_t *shm)
@@ -58,114 +33,16 @@ _jack_on_info_shutdown_cb(jack_status_t code, const char *reason, void *arg)
 	_close(shm);
 }
 
-static int
-_audio_monitor_process(jack_nframes_t nframes, void *arg)
-{
-	monitor_app_t *monitor = arg;
-	monitor_shm_t *shm = monitor->shm;
-
-	if(  atomic_load_explicit(&closed, memory_order_relaxed)
-		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
-	{
-		return 0;
-	}
-
-	const float *psinks [PORT_MAX];
-
-	const unsigned nsinks = shm->nsinks;
-
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-		jack_port_t *jsink = monitor->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
-
-		float peak = 0.f;
-		for(unsigned k = 0; k < nframes; k++)
-		{
-			const float sample = fabsf(psinks[i][k]);
-			if(sample > peak)
-				peak = sample;
-		}
-
-		// go to zero in 1/2 s
-		if(monitor->audio.dBFSs[i] > -64.f)
-			monitor->audio.dBFSs[i] -= nframes * 70.f * 2.f * monitor->sample_rate_1;
-
-		const float dBFS = (peak > 0.f)
-			? 6.f + 20.f*log10f(peak / 2.f) // dBFS+6
-			: -64.f;
-
-		if(dBFS > monitor->audio.dBFSs[i])
-			monitor->audio.dBFSs[i] = dBFS;
-
-		const int32_t mBFS = rintf(monitor->audio.dBFSs[i] * 100.f);
-		atomic_store_explicit(&shm->jgains[i], mBFS, memory_order_relaxed);
-	}
-
-	return 0;
-}
-
-static int
-_midi_monitor_process(jack_nframes_t nframes, void *arg)
-{
-	monitor_app_t *monitor = arg;
-	monitor_shm_t *shm = monitor->shm;
-
-	if(  atomic_load_explicit(&closed, memory_order_relaxed)
-		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
-	{
-		return 0;
-	}
-
-	void *psinks [PORT_MAX];
-
-	const unsigned nsinks = shm->nsinks;
-
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-		jack_port_t *jsink = monitor->jsinks[i];
-		psinks[i] = jack_port_get_buffer(jsink, nframes);
-
-		float vel = 0.f;
-		const uint32_t count = jack_midi_get_event_count(psinks[i]);
-		for(unsigned k = 0; k < count; k++)
-		{
-			jack_midi_event_t ev;
-			jack_midi_event_get(&ev, psinks[i], k);
-
-			if(ev.size != 3)
-				continue;
-
-			if( (ev.buffer[0] & 0xf0) == 0x90)
-			{
-				if(ev.buffer[2] > vel)
-					vel = ev.buffer[2];
-			}
-		}
-
-		// go to zero in 1/2 s
-		if(monitor->midi.vels[i] > 0.f)
-			monitor->midi.vels[i] -= nframes * 127.f * 2.f * monitor->sample_rate_1;
-
-		if(vel > monitor->midi.vels[i])
-			monitor->midi.vels[i] = vel;
-
-		const int32_t cvel = rintf(monitor->midi.vels[i] * 100.f);
-		atomic_store_explicit(&shm->jgains[i], cvel, memory_order_relaxed);
-	}
-
-	return 0;
-}
-
 int
 main(int argc, char **argv)
 {
 	static monitor_app_t monitor;
-	const size_t total_size = sizeof(monitor_shm_t);
+	static monitor_app_t next;
 
 	const char *server_name = NULL;
 	unsigned nsinks = 1;
 	monitor.type = TYPE_AUDIO;
+	monitor.mode = MONITOR_PEAK;
 
 	fprintf(stderr,
 		"%s "PATCHMATRIX_VERSION"\n"
@@ -173,7 +50,7 @@ main(int argc, char **argv)
 		"Released under Artistic License 2.0 by Open Music Kontrollers\n", argv[0]);
 
 	int c;
-	while((c = getopt(argc, argv, "vht:i:n:")) != -1)
+	while((c = getopt(argc, argv, "vht:i:m:n:")) != -1)
 	{
 		switch(c)
 		{
@@ -202,8 +79,10 @@ main(int argc, char **argv)
 					"OPTIONS\n"
 					"   [-v]                 print version and full license information\n"
 					"   [-h]                 print usage information\n"
-					"   [-t] port-type       port type (audio, midi)\n"
+					"   [-t] port-type       port type (audio, midi, osc, cv)\n"
 					"   [-i] input-num       port input number (1-%i)\n"
+					"   [-m] meter-mode      audio meter mode (peak, rms, lufs, true-peak, spectrum,\n"
+					"                        correlation)\n"
 					"   [-n] server-name     connect to named JACK daemon\n\n"
 					, argv[0], PORT_MAX);
 				return 0;
@@ -218,9 +97,17 @@ main(int argc, char **argv)
 				if(nsinks > PORT_MAX)
 					nsinks = PORT_MAX;
 				break;
+			case 'm':
+				monitor.mode = _monitor_mode_from_string(optarg);
+				if(monitor.mode == MONITOR_MAX)
+				{
+					fprintf(stderr, "Unknown meter mode `%s'.\n", optarg);
+					return -1;
+				}
+				break;
 			case '?':
 				if( (optopt == 'n') || (optopt == 'u') || (optopt == 't')
-						|| (optopt == 'i') || (optopt == 'd') )
+						|| (optopt == 'i') || (optopt == 'm') || (optopt == 'd') )
 					fprintf(stderr, "Option `-%c' requires an argument.\n", optopt);
 				else if(isprint(optopt))
 					fprintf(stderr, "Unknown option `-%c'.\n", optopt);
@@ -232,6 +119,15 @@ main(int argc, char **argv)
 		}
 	}
 
+	if(monitor.type != TYPE_AUDIO) // velocities, messages and CV are not integrated
+		monitor.mode = MONITOR_PEAK;
+
+	if(_monitor_app_alloc(&monitor, nsinks) == -1)
+	{
+		fprintf(stderr, "failed to allocate monitor\n");
+		return -1;
+	}
+
 	jack_options_t opts = JackNullOption | JackNoStartServer;
 	if(server_name)
 		opts |= JackServerName;
@@ -240,90 +136,48 @@ main(int argc, char **argv)
 	monitor.client = jack_client_open(PATCHMATRIX_MONITOR_ID, opts, &status,
 		server_name ? server_name : NULL);
 	if(!monitor.client)
+	{
+		_monitor_app_free(&monitor);
 		return -1;
+	}
 
-	monitor.sample_rate_1 = 1.f / jack_get_sample_rate(monitor.client);
+	snprintf(monitor.name, NAME_MAX_LEN, "%s", jack_get_client_name(monitor.client));
+	const jack_nframes_t sample_rate = jack_get_sample_rate(monitor.client);
+	_monitor_sample_rate_init(&monitor, sample_rate);
 
-	for(unsigned i = 0; i < nsinks; i++)
+	if(  (_monitor_ports_register(&monitor) == 0)
+		&& (_monitor_shm_open(&monitor, 0) == 0) )
 	{
-		char buf [32];
-		snprintf(buf, 32, "sink_%02u", i + 1);
-
-		jack_port_t *jsink = jack_port_register(monitor.client, buf,
-			monitor.type == TYPE_AUDIO ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
-			JackPortIsInput | JackPortIsTerminal, 0);
-
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(jsink);
-
-		snprintf(buf, 32, "%u", i);
-		jack_set_property(monitor.client, uuid, JACKEY_ORDER, buf, XSD__integer);
-
-		snprintf(buf, 32, "Sink %u", i + 1);
-		jack_set_property(monitor.client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
-#endif
+		jack_on_info_shutdown(monitor.client, _jack_on_info_shutdown_cb, &monitor);
+		jack_set_process_callback(monitor.client, _monitor_process_callback(monitor.type),
+			&monitor);
 
-		if(monitor.type == TYPE_AUDIO)
-			monitor.audio.dBFSs[i] = -64.f;
-		else if(monitor.type == TYPE_MIDI)
-			monitor.midi.vels[i] = 0.f;
+		if(monitor.mode == MONITOR_CORRELATION)
+			_monitor_pairs_init(&monitor);
 
-		monitor.jsinks[i] = jsink;
-	}
-
-	const char *client_name = jack_get_client_name(monitor.client);
-	const int fd = shm_open(client_name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-	if(fd != -1)
-	{
-		if(ftruncate(fd, total_size) != -1)
+		if( (monitor.mode == MONITOR_SPECTRUM)
+			&& (_monitor_spectrum_start(&monitor, sample_rate) == -1) )
 		{
-			if((monitor.shm = mmap(NULL, total_size, PROT_READ | PROT_WRITE,
-				MAP_SHARED, fd, 0)) != MAP_FAILED)
-			{
-				monitor.shm->nsinks = nsinks;
-
-				atomic_init(&monitor.shm->closing, false);
-
-				for(unsigned i = 0; i < nsinks; i++)
-					atomic_init(&monitor.shm->jgains[i], 0);
+			fprintf(stderr, "failed to start spectrum worker\n");
+		}
 
-				if(sem_init(&monitor.shm->done, 1, 0) != -1)
-				{
-					jack_on_info_shutdown(monitor.client, _jack_on_info_shutdown_cb, &monitor);
-					jack_set_process_callback(monitor.client,
-						monitor.type == TYPE_AUDIO ? _audio_monitor_process : _midi_monitor_process,
-						&monitor);
-					//TODO CV
+		jack_activate(monitor.client);
 
-					jack_activate(monitor.client);
+		_monitor_run(&monitor, &next);
 
-					sem_wait(&monitor.shm->done);
-					atomic_store_explicit(&monitor.shm->closing, true, memory_order_relaxed);
+		jack_deactivate(monitor.client);
 
-					jack_deactivate(monitor.client);
+		_monitor_spectrum_stop(&monitor);
 
-					sem_destroy(&monitor.shm->done);
-				}
-
-				atomic_store_explicit(&closed, true, memory_order_relaxed);
-				munmap(monitor.shm, total_size);
-			}
-		}
-
-		close(fd);
-		shm_unlink(client_name);
+		atomic_store_explicit(&monitor_closed, true, memory_order_relaxed);
+		_monitor_shm_close(&monitor);
 	}
 
-	for(unsigned i = 0; i < nsinks; i++)
-	{
-#ifdef JACK_HAS_METADATA_API
-		jack_uuid_t uuid = jack_port_uuid(monitor.jsinks[i]);
-		jack_remove_properties(monitor.client, uuid);
-#endif
-		jack_port_unregister(monitor.client, monitor.jsinks[i]);
-	}
+	_monitor_ports_unregister(&monitor);
 
 	jack_client_close(monitor.client);
 
+	_monitor_app_free(&monitor);
+
 	return 0;
 }
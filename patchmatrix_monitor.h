@@ -0,0 +1,2612 @@
+/*
+ * Copyright (c) 2016-2021 Hanspeter Portner (dev@open-music-kontrollers.ch)
+ *
+ * This is free software: you can redistribute it and/or modify
+ * it under the terms of the Artistic License 2.0 as published by
+ * The Perl Foundation.
+ *
+ * This sink is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the iapplied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * Artistic License 2.0 for more details.
+ *
+ * You should have received a copy of the Artistic License 2.0
+ * along the sink as a COPYING file. If not, obtain it from
+ * http://www.perlfoundation.org/artistic_license_2_0.
+ */
+
+#ifndef _PATCHMATRIX_MONITOR_H
+#define _PATCHMATRIX_MONITOR_H
+
+#include <patchmatrix.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <float.h>
+
+#include <osc.lv2/reader.h>
+
+#define MONITOR_GROUPS 2 // groups of sinks metered in one pass
+#define MONITOR_BLOCK_RATE 10 // blocks per second, meters integrate whole blocks
+#define MONITOR_BLOCKS 30 // 3 s worth of blocks, longest window
+#define MONITOR_DENORMAL 1e-20f // DC offset keeps filter states normal, removed by highpass
+#define MONITOR_PHASES 4 // of true-peak interpolator
+#define MONITOR_TAPS 12 // per phase of true-peak interpolator
+#define MONITOR_CHUNK 256 // frames interpolated at once, bounds stack use
+#define MONITOR_FFT 2048 // frames per transform of spectrum
+#define MONITOR_HOP (MONITOR_FFT / 2) // frames between transforms
+#define MONITOR_FLOOR 20.f // lower edge of spectrum in Hz
+#define MONITOR_SPECTRUM_SIZE 0x400000 // of ring to spectrum worker
+#define MONITOR_DECIMATE 16 // frames per goniometer point
+#define MONITOR_SILENCE 1e-12f // mean square below which pairs have no correlation
+
+typedef struct _monitor_kweight_t monitor_kweight_t;
+typedef struct _monitor_meter_t monitor_meter_t;
+typedef struct _monitor_chunk_t monitor_chunk_t;
+typedef struct _monitor_spectrum_t monitor_spectrum_t;
+typedef struct _monitor_corr_t monitor_corr_t;
+typedef struct _monitor_app_t monitor_app_t;
+
+typedef void (*monitor_kweights_t)(monitor_meter_t *meters,
+	const monitor_kweight_t *kw, const float *const *psinks,
+	jack_nframes_t offset, jack_nframes_t nframes);
+
+typedef float (*monitor_true_peak_t)(const float *window,
+	jack_nframes_t nframes, float peak);
+
+typedef void (*monitor_correlate_t)(const float *left, const float *right,
+	jack_nframes_t nframes, float sums [3]);
+
+// ITU-R BS.1770 pre-filter: high shelf, then highpass, a0 normalised to 1
+struct _monitor_kweight_t {
+	float b [3]; // of shelf, highpass has 1, -2, 1
+	float a [2][2];
+};
+
+// state of a group of sinks, lanes side by side so that they run in parallel
+struct _monitor_meter_t {
+	float z [4][MONITOR_LANES]; // delay lines of both K-weighting biquads
+	float sum [MONITOR_LANES]; // of squares in current block
+	float peak [MONITOR_LANES]; // of current cycle
+	float blocks [MONITOR_BLOCKS][MONITOR_LANES]; // ring of block mean squares
+	float windows [MONITOR_SLOTS][MONITOR_LANES]; // sliding sums over last blocks
+	float taps [MONITOR_LANES][MONITOR_TAPS - 1]; // last frames of each sink
+};
+
+// blocks integrated per published slot, 0: sample peak of cycle
+static const unsigned monitor_windows [MONITOR_MAX][MONITOR_SLOTS] = {
+	[MONITOR_PEAK] = {0, 0},
+	[MONITOR_RMS] = {3, 0},
+	[MONITOR_LUFS] = {4, 30},
+	[MONITOR_TRUE_PEAK] = {0, 0},
+	[MONITOR_SPECTRUM] = {0, 0},
+	[MONITOR_CORRELATION] = {0, 0}
+};
+
+// modes that integrate state per sink across cycles
+static inline bool
+_monitor_mode_metered(monitor_mode_t mode)
+{
+	return (mode == MONITOR_RMS) || (mode == MONITOR_LUFS) || (mode == MONITOR_TRUE_PEAK);
+}
+
+// cycle of audio handed over to spectrum worker
+struct _monitor_chunk_t {
+	uint32_t nsinks;
+	uint32_t nframes;
+	float frames []; // [nsinks][nframes]
+};
+
+struct _monitor_spectrum_t {
+	varchunk_t *rx; // cycles of audio from RT thread to worker
+	sem_t wake; // posted by RT thread after each cycle
+	pthread_t thread;
+	atomic_bool quit;
+
+	pthread_mutex_t lock; // held by worker while publishing, by main thread while resizing
+	monitor_shm_t *shm; // current mapping, guarded by lock
+	unsigned nsinks; // of shm layout, guarded by lock
+
+	// worker only
+	float *bufs; // [nbufs][MONITOR_FFT] rings of last frames per sink
+	unsigned nbufs;
+	unsigned pos; // of oldest frame in rings
+	unsigned fill; // frames since last transform
+	float window [MONITOR_FFT]; // Hann
+	float cos [MONITOR_FFT/2];
+	float sin [MONITOR_FFT/2]; // negated, for forward transform
+	uint16_t rev [MONITOR_FFT/2]; // bit-reversed indices
+	uint16_t lo [MONITOR_BANDS]; // first bin of band
+	uint16_t hi [MONITOR_BANDS]; // bin past band
+	float re [MONITOR_FFT/2];
+	float im [MONITOR_FFT/2];
+	float amps [MONITOR_FFT/2]; // per bin
+	float bands [MONITOR_BANDS];
+};
+
+// pair of sinks in correlation mode
+struct _monitor_corr_t {
+	unsigned left;
+	unsigned right;
+	float sums [3]; // of left and right squares and their products in current block
+};
+
+struct _monitor_app_t {
+	jack_client_t *client;
+	jack_port_t **jsinks; // [nsinks]
+	monitor_meter_t *meters; // [ngroups] in metered modes only
+	monitor_stats_t *stats; // [ngroups] of current history entry
+	monitor_corr_t *corrs; // [nsinks/2] in correlation mode only
+	monitor_block_t *blocks; // [nsinks] of current block in CV type only, mean is sum so far
+	port_type_t type;
+	unsigned nsinks;
+	unsigned ncorrs; // pairs found among sinks
+
+	void *mem; // backs all of the above
+	size_t mem_size;
+
+	atomic_int sync; // handshake with main thread for resizing
+	bool frozen; // do not touch shm while main thread lays it out anew
+	monitor_app_t *next; // state prepared by main thread to swap in
+
+	monitor_shm_t *shm;	
+	monitor_scan_t scan; // extremes and squares kernel picked for this CPU
+	jack_nframes_t hblock; // frames per history entry
+	jack_nframes_t hfill; // frames in current history entry
+	uint32_t hhead; // history entries written so far
+
+	monitor_mode_t mode;
+	monitor_kweight_t kweight;
+	monitor_kweights_t kweights; // K-weighting kernel picked for this CPU
+	monitor_true_peak_t true_peak; // interpolator picked for this CPU
+	monitor_spectrum_t *spectrum; // worker in spectrum mode, else NULL
+	monitor_correlate_t correlate; // correlation kernel picked for this CPU
+	jack_nframes_t phase; // frames to next goniometer point
+	uint32_t point; // goniometer points written so far
+	jack_nframes_t block; // frames per block
+	jack_nframes_t fill; // frames in current block
+	unsigned head; // of block ring
+
+	// main thread only
+	char name [NAME_MAX_LEN]; // of shm segment, port group when hosted
+	bool hosted; // shares JACK client with other instances
+	int fd; // of shm segment
+	size_t shm_size; // of current mapping
+};
+
+static inline bool
+_monitor_is_cv(monitor_app_t *monitor)
+{
+#ifdef JACK_HAS_METADATA_API
+	return monitor->type == TYPE_CV;
+#else
+	return false;
+#endif
+}
+
+// merge extremes and sums of one stretch into those of a longer one
+static inline void
+_audio_monitor_stats_merge(monitor_stats_t *dst, const monitor_stats_t *src)
+{
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		if(src->min[l] < dst->min[l])
+			dst->min[l] = src->min[l];
+		if(src->max[l] > dst->max[l])
+			dst->max[l] = src->max[l];
+		dst->sum[l] += src->sum[l];
+	}
+}
+
+// empty extremes, so that first merged span sets them, -ffast-math rules out infinities
+static inline void
+_audio_monitor_stats_reset(monitor_stats_t *stats)
+{
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		stats->min[l] = FLT_MAX;
+		stats->max[l] = -FLT_MAX;
+		stats->sum[l] = 0.f;
+	}
+}
+
+// meters are allocated for whole passes
+static inline unsigned
+_monitor_groups(unsigned nsinks)
+{
+	const unsigned pass = MONITOR_GROUPS*MONITOR_LANES;
+
+	return (nsinks + pass - 1) / pass * MONITOR_GROUPS;
+}
+
+// coefficients as of ITU-R BS.1770, rederived for sample rates other than 48 kHz
+static void
+_monitor_kweight_init(monitor_kweight_t *kw, jack_nframes_t sample_rate)
+{
+	{
+		const double f0 = 1681.974450955533;
+		const double G = 3.999843853973347;
+		const double Q = 0.7071752369554196;
+		const double K = tan(M_PI * f0 / sample_rate);
+		const double Vh = pow(10.0, G / 20.0);
+		const double Vb = pow(Vh, 0.4996667741545416);
+		const double a0 = 1.0 + K / Q + K * K;
+
+		kw->b[0] = (Vh + Vb * K / Q + K * K) / a0;
+		kw->b[1] = 2.0 * (K * K - Vh) / a0;
+		kw->b[2] = (Vh - Vb * K / Q + K * K) / a0;
+		kw->a[0][0] = 2.0 * (K * K - 1.0) / a0;
+		kw->a[0][1] = (1.0 - K / Q + K * K) / a0;
+	}
+
+	{
+		const double f0 = 38.13547087602444;
+		const double Q = 0.5003270373238773;
+		const double K = tan(M_PI * f0 / sample_rate);
+		const double a0 = 1.0 + K / Q + K * K;
+
+		kw->a[1][0] = 2.0 * (K * K - 1.0) / a0;
+		kw->a[1][1] = (1.0 - K / Q + K * K) / a0;
+	}
+}
+
+static void
+_monitor_sample_rate_init(monitor_app_t *monitor, jack_nframes_t sample_rate)
+{
+	monitor->block = sample_rate / MONITOR_BLOCK_RATE;
+	monitor->fill = 0;
+	monitor->head = 0;
+
+	monitor->hblock = sample_rate / MONITOR_HISTORY_RATE;
+	monitor->hfill = 0;
+	monitor->hhead = 0;
+
+	_monitor_kweight_init(&monitor->kweight, sample_rate);
+}
+
+// sums of squares and sample peaks in one scan
+static void
+_audio_monitor_rms(monitor_app_t *monitor, monitor_meter_t *meter,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	const float *pspans [MONITOR_LANES];
+	monitor_stats_t stats;
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+		pspans[l] = &psinks[l][offset];
+
+	memset(&stats, 0x0, sizeof(stats));
+	monitor->scan(pspans, nframes, &stats);
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		const float peak = _audio_monitor_stats_peak(&stats, l);
+
+		meter->sum[l] += stats.sum[l];
+		if(peak > meter->peak[l])
+			meter->peak[l] = peak;
+	}
+}
+
+// both biquads in transposed direct form II, lanes side by side to vectorise
+static void
+_audio_monitor_kweight_c(monitor_meter_t *meter, const monitor_kweight_t *kw,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	float z0 [MONITOR_LANES];
+	float z1 [MONITOR_LANES];
+	float z2 [MONITOR_LANES];
+	float z3 [MONITOR_LANES];
+	float sum [MONITOR_LANES];
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		z0[l] = meter->z[0][l];
+		z1[l] = meter->z[1][l];
+		z2[l] = meter->z[2][l];
+		z3[l] = meter->z[3][l];
+		sum[l] = meter->sum[l];
+	}
+
+	for(unsigned k = offset; k < offset + nframes; k++)
+	{
+		for(unsigned l = 0; l < MONITOR_LANES; l++)
+		{
+			const float x = psinks[l][k] + MONITOR_DENORMAL;
+			const float y = kw->b[0]*x + z0[l];
+			z0[l] = kw->b[1]*x - kw->a[0][0]*y + z1[l];
+			z1[l] = kw->b[2]*x - kw->a[0][1]*y;
+
+			const float w = y + z2[l];
+			z2[l] = z3[l] - 2.f*y - kw->a[1][0]*w;
+			z3[l] = y - kw->a[1][1]*w;
+
+			sum[l] += w*w;
+		}
+	}
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		meter->z[0][l] = z0[l];
+		meter->z[1][l] = z1[l];
+		meter->z[2][l] = z2[l];
+		meter->z[3][l] = z3[l];
+		meter->sum[l] = sum[l];
+	}
+}
+
+#if defined(MONITOR_SSE)
+static void
+_audio_monitor_kweights_sse(monitor_meter_t *meters, const monitor_kweight_t *kw,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	const __m128 dc = _mm_set1_ps(MONITOR_DENORMAL);
+	const __m128 b0 = _mm_set1_ps(kw->b[0]);
+	const __m128 b1 = _mm_set1_ps(kw->b[1]);
+	const __m128 b2 = _mm_set1_ps(kw->b[2]);
+	const __m128 a00 = _mm_set1_ps(kw->a[0][0]);
+	const __m128 a01 = _mm_set1_ps(kw->a[0][1]);
+	const __m128 a10 = _mm_set1_ps(kw->a[1][0]);
+	const __m128 a11 = _mm_set1_ps(kw->a[1][1]);
+	__m128 z0 [MONITOR_GROUPS];
+	__m128 z1 [MONITOR_GROUPS];
+	__m128 z2 [MONITOR_GROUPS];
+	__m128 z3 [MONITOR_GROUPS];
+	__m128 sum [MONITOR_GROUPS];
+
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		z0[g] = _mm_loadu_ps(meters[g].z[0]);
+		z1[g] = _mm_loadu_ps(meters[g].z[1]);
+		z2[g] = _mm_loadu_ps(meters[g].z[2]);
+		z3[g] = _mm_loadu_ps(meters[g].z[3]);
+		sum[g] = _mm_loadu_ps(meters[g].sum);
+	}
+
+	for(unsigned k = offset; k < offset + nframes; k++)
+	{
+		// groups are independent recursions, which thus overlap in the pipeline
+		for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+		{
+			const float *const *p = &psinks[g*MONITOR_LANES];
+			const __m128 x = _mm_add_ps(_mm_set_ps(p[3][k], p[2][k], p[1][k], p[0][k]), dc);
+
+			// feedback last, so that recursion only runs through add, mul and sub
+			const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), z0[g]);
+			z0[g] = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(b1, x), z1[g]), _mm_mul_ps(a00, y));
+			z1[g] = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a01, y));
+
+			const __m128 w = _mm_add_ps(y, z2[g]);
+			z2[g] = _mm_sub_ps(_mm_sub_ps(z3[g], _mm_add_ps(y, y)), _mm_mul_ps(a10, w));
+			z3[g] = _mm_sub_ps(y, _mm_mul_ps(a11, w));
+
+			sum[g] = _mm_add_ps(_mm_mul_ps(w, w), sum[g]);
+		}
+	}
+
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		_mm_storeu_ps(meters[g].z[0], z0[g]);
+		_mm_storeu_ps(meters[g].z[1], z1[g]);
+		_mm_storeu_ps(meters[g].z[2], z2[g]);
+		_mm_storeu_ps(meters[g].z[3], z3[g]);
+		_mm_storeu_ps(meters[g].sum, sum[g]);
+	}
+}
+#endif
+
+#if defined(MONITOR_AVX)
+// both groups side by side in one register
+__attribute__((target("avx")))
+static void
+_audio_monitor_kweights_avx(monitor_meter_t *meters, const monitor_kweight_t *kw,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	const float *const *p = psinks;
+	const __m256 dc = _mm256_set1_ps(MONITOR_DENORMAL);
+	const __m256 b0 = _mm256_set1_ps(kw->b[0]);
+	const __m256 b1 = _mm256_set1_ps(kw->b[1]);
+	const __m256 b2 = _mm256_set1_ps(kw->b[2]);
+	const __m256 a00 = _mm256_set1_ps(kw->a[0][0]);
+	const __m256 a01 = _mm256_set1_ps(kw->a[0][1]);
+	const __m256 a10 = _mm256_set1_ps(kw->a[1][0]);
+	const __m256 a11 = _mm256_set1_ps(kw->a[1][1]);
+	__m256 z0 = _mm256_loadu2_m128(meters[1].z[0], meters[0].z[0]);
+	__m256 z1 = _mm256_loadu2_m128(meters[1].z[1], meters[0].z[1]);
+	__m256 z2 = _mm256_loadu2_m128(meters[1].z[2], meters[0].z[2]);
+	__m256 z3 = _mm256_loadu2_m128(meters[1].z[3], meters[0].z[3]);
+	__m256 sum = _mm256_loadu2_m128(meters[1].sum, meters[0].sum);
+
+	for(unsigned k = offset; k < offset + nframes; k++)
+	{
+		const __m256 x = _mm256_add_ps(_mm256_set_ps(p[7][k], p[6][k], p[5][k], p[4][k],
+			p[3][k], p[2][k], p[1][k], p[0][k]), dc);
+
+		const __m256 y = _mm256_add_ps(_mm256_mul_ps(b0, x), z0);
+		z0 = _mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(b1, x), z1), _mm256_mul_ps(a00, y));
+		z1 = _mm256_sub_ps(_mm256_mul_ps(b2, x), _mm256_mul_ps(a01, y));
+
+		const __m256 w = _mm256_add_ps(y, z2);
+		z2 = _mm256_sub_ps(_mm256_sub_ps(z3, _mm256_add_ps(y, y)), _mm256_mul_ps(a10, w));
+		z3 = _mm256_sub_ps(y, _mm256_mul_ps(a11, w));
+
+		sum = _mm256_add_ps(_mm256_mul_ps(w, w), sum);
+	}
+
+	_mm256_storeu2_m128(meters[1].z[0], meters[0].z[0], z0);
+	_mm256_storeu2_m128(meters[1].z[1], meters[0].z[1], z1);
+	_mm256_storeu2_m128(meters[1].z[2], meters[0].z[2], z2);
+	_mm256_storeu2_m128(meters[1].z[3], meters[0].z[3], z3);
+	_mm256_storeu2_m128(meters[1].sum, meters[0].sum, sum);
+}
+#endif
+
+#if defined(MONITOR_NEON)
+static void
+_audio_monitor_kweights_neon(monitor_meter_t *meters, const monitor_kweight_t *kw,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	const float32x4_t dc = vdupq_n_f32(MONITOR_DENORMAL);
+	float32x4_t z0 [MONITOR_GROUPS];
+	float32x4_t z1 [MONITOR_GROUPS];
+	float32x4_t z2 [MONITOR_GROUPS];
+	float32x4_t z3 [MONITOR_GROUPS];
+	float32x4_t sum [MONITOR_GROUPS];
+
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		z0[g] = vld1q_f32(meters[g].z[0]);
+		z1[g] = vld1q_f32(meters[g].z[1]);
+		z2[g] = vld1q_f32(meters[g].z[2]);
+		z3[g] = vld1q_f32(meters[g].z[3]);
+		sum[g] = vld1q_f32(meters[g].sum);
+	}
+
+	for(unsigned k = offset; k < offset + nframes; k++)
+	{
+		for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+		{
+			const float *const *p = &psinks[g*MONITOR_LANES];
+			float32x4_t x = vdupq_n_f32(p[0][k]);
+			x = vsetq_lane_f32(p[1][k], x, 1);
+			x = vsetq_lane_f32(p[2][k], x, 2);
+			x = vsetq_lane_f32(p[3][k], x, 3);
+			x = vaddq_f32(x, dc);
+
+			const float32x4_t y = vmlaq_n_f32(z0[g], x, kw->b[0]);
+			z0[g] = vmlsq_n_f32(vmlaq_n_f32(z1[g], x, kw->b[1]), y, kw->a[0][0]);
+			z1[g] = vmlsq_n_f32(vmulq_n_f32(x, kw->b[2]), y, kw->a[0][1]);
+
+			const float32x4_t w = vaddq_f32(z2[g], y);
+			z2[g] = vmlsq_n_f32(vmlsq_n_f32(z3[g], y, 2.f), w, kw->a[1][0]);
+			z3[g] = vmlsq_n_f32(y, w, kw->a[1][1]);
+
+			sum[g] = vmlaq_f32(sum[g], w, w);
+		}
+	}
+
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		vst1q_f32(meters[g].z[0], z0[g]);
+		vst1q_f32(meters[g].z[1], z1[g]);
+		vst1q_f32(meters[g].z[2], z2[g]);
+		vst1q_f32(meters[g].z[3], z3[g]);
+		vst1q_f32(meters[g].sum, sum[g]);
+	}
+}
+#endif
+
+static void
+_audio_monitor_kweights_c(monitor_meter_t *meters, const monitor_kweight_t *kw,
+	const float *const *psinks, jack_nframes_t offset, jack_nframes_t nframes)
+{
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		_audio_monitor_kweight_c(&meters[g], kw, &psinks[g*MONITOR_LANES],
+			offset, nframes);
+	}
+}
+
+static monitor_kweights_t
+_audio_monitor_kweights_select(void)
+{
+#if defined(MONITOR_AVX)
+	if(__builtin_cpu_supports("avx"))
+		return _audio_monitor_kweights_avx;
+#endif
+#if defined(MONITOR_SSE)
+	return _audio_monitor_kweights_sse;
+#elif defined(MONITOR_NEON)
+	return _audio_monitor_kweights_neon;
+#else
+	return _audio_monitor_kweights_c;
+#endif
+}
+
+// 4x interpolator of ITU-R BS.1770 Annex 2, all phases share window of frames
+static const float monitor_true_peak_fir [MONITOR_PHASES][MONITOR_TAPS] = {
+	{  0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f,
+		-0.0594482421875f,  0.1373291015625f,  0.9721679687500f, -0.1022949218750f,
+		 0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+	{ -0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f,
+		-0.1665039062500f,  0.4650878906250f,  0.7797851562500f, -0.2003173828125f,
+		 0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+	{ -0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f,
+		-0.2003173828125f,  0.7797851562500f,  0.4650878906250f, -0.1665039062500f,
+		 0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+	{ -0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f,
+		-0.1022949218750f,  0.9721679687500f,  0.1373291015625f, -0.0594482421875f,
+		 0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f }
+};
+
+// abs-max of interpolated frames, window reaches MONITOR_TAPS - 1 frames ahead
+static float
+_audio_monitor_true_peak_c(const float *window, jack_nframes_t nframes, float peak)
+{
+	for(unsigned k = 0; k < nframes; k++)
+	{
+		for(unsigned p = 0; p < MONITOR_PHASES; p++)
+		{
+			float y = 0.f;
+
+			for(unsigned j = 0; j < MONITOR_TAPS; j++)
+				y += monitor_true_peak_fir[p][j] * window[k + j];
+
+			if(fabsf(y) > peak)
+				peak = fabsf(y);
+		}
+	}
+
+	return peak;
+}
+
+#if defined(MONITOR_SSE)
+// consecutive frames side by side, one accumulator per phase
+static float
+_audio_monitor_true_peak_sse(const float *window, jack_nframes_t nframes, float peak)
+{
+	const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 m = _mm_setzero_ps();
+	unsigned k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		__m128 y0 = _mm_setzero_ps();
+		__m128 y1 = _mm_setzero_ps();
+		__m128 y2 = _mm_setzero_ps();
+		__m128 y3 = _mm_setzero_ps();
+
+		for(unsigned j = 0; j < MONITOR_TAPS; j++)
+		{
+			const __m128 x = _mm_loadu_ps(&window[k + j]);
+
+			y0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(monitor_true_peak_fir[0][j]), x), y0);
+			y1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(monitor_true_peak_fir[1][j]), x), y1);
+			y2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(monitor_true_peak_fir[2][j]), x), y2);
+			y3 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(monitor_true_peak_fir[3][j]), x), y3);
+		}
+
+		y0 = _mm_and_ps(y0, abs);
+		y1 = _mm_and_ps(y1, abs);
+		y2 = _mm_and_ps(y2, abs);
+		y3 = _mm_and_ps(y3, abs);
+		m = _mm_max_ps(_mm_max_ps(_mm_max_ps(y0, y1), _mm_max_ps(y2, y3)), m);
+	}
+
+	float peaks [4];
+	_mm_storeu_ps(peaks, m);
+
+	for(unsigned l = 0; l < 4; l++)
+	{
+		if(peaks[l] > peak)
+			peak = peaks[l];
+	}
+
+	return _audio_monitor_true_peak_c(&window[k], nframes - k, peak);
+}
+#endif
+
+#if defined(MONITOR_AVX)
+__attribute__((target("avx")))
+static float
+_audio_monitor_true_peak_avx(const float *window, jack_nframes_t nframes, float peak)
+{
+	const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 m = _mm256_setzero_ps();
+	unsigned k = 0;
+
+	for( ; k + 8 <= nframes; k += 8)
+	{
+		__m256 y0 = _mm256_setzero_ps();
+		__m256 y1 = _mm256_setzero_ps();
+		__m256 y2 = _mm256_setzero_ps();
+		__m256 y3 = _mm256_setzero_ps();
+
+		for(unsigned j = 0; j < MONITOR_TAPS; j++)
+		{
+			const __m256 x = _mm256_loadu_ps(&window[k + j]);
+
+			y0 = _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&monitor_true_peak_fir[0][j]), x), y0);
+			y1 = _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&monitor_true_peak_fir[1][j]), x), y1);
+			y2 = _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&monitor_true_peak_fir[2][j]), x), y2);
+			y3 = _mm256_add_ps(_mm256_mul_ps(_mm256_broadcast_ss(&monitor_true_peak_fir[3][j]), x), y3);
+		}
+
+		y0 = _mm256_and_ps(y0, abs);
+		y1 = _mm256_and_ps(y1, abs);
+		y2 = _mm256_and_ps(y2, abs);
+		y3 = _mm256_and_ps(y3, abs);
+		m = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(y0, y1), _mm256_max_ps(y2, y3)), m);
+	}
+
+	float peaks [4];
+	_mm_storeu_ps(peaks, _audio_monitor_fold_max_avx(m));
+
+	for(unsigned l = 0; l < 4; l++)
+	{
+		if(peaks[l] > peak)
+			peak = peaks[l];
+	}
+
+	return _audio_monitor_true_peak_c(&window[k], nframes - k, peak);
+}
+#endif
+
+#if defined(MONITOR_FMA)
+// two vectors of frames per step, so that fused multiply-adds outnumber loads
+__attribute__((target("avx,fma")))
+static float
+_audio_monitor_true_peak_fma(const float *window, jack_nframes_t nframes, float peak)
+{
+	const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	__m256 m = _mm256_setzero_ps();
+	unsigned k = 0;
+
+	for( ; k + 16 <= nframes; k += 16)
+	{
+		__m256 y0 = _mm256_setzero_ps();
+		__m256 y1 = _mm256_setzero_ps();
+		__m256 y2 = _mm256_setzero_ps();
+		__m256 y3 = _mm256_setzero_ps();
+		__m256 y4 = _mm256_setzero_ps();
+		__m256 y5 = _mm256_setzero_ps();
+		__m256 y6 = _mm256_setzero_ps();
+		__m256 y7 = _mm256_setzero_ps();
+
+		for(unsigned j = 0; j < MONITOR_TAPS; j++)
+		{
+			const __m256 x0 = _mm256_loadu_ps(&window[k + j]);
+			const __m256 x1 = _mm256_loadu_ps(&window[k + j + 8]);
+			const __m256 h0 = _mm256_broadcast_ss(&monitor_true_peak_fir[0][j]);
+			const __m256 h1 = _mm256_broadcast_ss(&monitor_true_peak_fir[1][j]);
+			const __m256 h2 = _mm256_broadcast_ss(&monitor_true_peak_fir[2][j]);
+			const __m256 h3 = _mm256_broadcast_ss(&monitor_true_peak_fir[3][j]);
+
+			y0 = _mm256_fmadd_ps(h0, x0, y0);
+			y1 = _mm256_fmadd_ps(h1, x0, y1);
+			y2 = _mm256_fmadd_ps(h2, x0, y2);
+			y3 = _mm256_fmadd_ps(h3, x0, y3);
+			y4 = _mm256_fmadd_ps(h0, x1, y4);
+			y5 = _mm256_fmadd_ps(h1, x1, y5);
+			y6 = _mm256_fmadd_ps(h2, x1, y6);
+			y7 = _mm256_fmadd_ps(h3, x1, y7);
+		}
+
+		y0 = _mm256_max_ps(_mm256_and_ps(y0, abs), _mm256_and_ps(y4, abs));
+		y1 = _mm256_max_ps(_mm256_and_ps(y1, abs), _mm256_and_ps(y5, abs));
+		y2 = _mm256_max_ps(_mm256_and_ps(y2, abs), _mm256_and_ps(y6, abs));
+		y3 = _mm256_max_ps(_mm256_and_ps(y3, abs), _mm256_and_ps(y7, abs));
+		m = _mm256_max_ps(_mm256_max_ps(_mm256_max_ps(y0, y1), _mm256_max_ps(y2, y3)), m);
+	}
+
+	float peaks [4];
+	_mm_storeu_ps(peaks, _audio_monitor_fold_max_avx(m));
+
+	for(unsigned l = 0; l < 4; l++)
+	{
+		if(peaks[l] > peak)
+			peak = peaks[l];
+	}
+
+	return _audio_monitor_true_peak_avx(&window[k], nframes - k, peak);
+}
+#endif
+
+#if defined(MONITOR_NEON)
+static float
+_audio_monitor_true_peak_neon(const float *window, jack_nframes_t nframes, float peak)
+{
+	float32x4_t m = vdupq_n_f32(0.f);
+	unsigned k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		float32x4_t y0 = vdupq_n_f32(0.f);
+		float32x4_t y1 = vdupq_n_f32(0.f);
+		float32x4_t y2 = vdupq_n_f32(0.f);
+		float32x4_t y3 = vdupq_n_f32(0.f);
+
+		for(unsigned j = 0; j < MONITOR_TAPS; j++)
+		{
+			const float32x4_t x = vld1q_f32(&window[k + j]);
+
+			y0 = vmlaq_n_f32(y0, x, monitor_true_peak_fir[0][j]);
+			y1 = vmlaq_n_f32(y1, x, monitor_true_peak_fir[1][j]);
+			y2 = vmlaq_n_f32(y2, x, monitor_true_peak_fir[2][j]);
+			y3 = vmlaq_n_f32(y3, x, monitor_true_peak_fir[3][j]);
+		}
+
+		m = vmaxq_f32(vmaxq_f32(vmaxq_f32(vabsq_f32(y0), vabsq_f32(y1)),
+			vmaxq_f32(vabsq_f32(y2), vabsq_f32(y3))), m);
+	}
+
+	const float max = vmaxvq_f32(m);
+	if(max > peak)
+		peak = max;
+
+	return _audio_monitor_true_peak_c(&window[k], nframes - k, peak);
+}
+#endif
+
+static monitor_true_peak_t
+_audio_monitor_true_peak_select(void)
+{
+#if defined(MONITOR_FMA)
+	if(__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma"))
+		return _audio_monitor_true_peak_fma;
+#endif
+#if defined(MONITOR_AVX)
+	if(__builtin_cpu_supports("avx"))
+		return _audio_monitor_true_peak_avx;
+#endif
+#if defined(MONITOR_SSE)
+	return _audio_monitor_true_peak_sse;
+#elif defined(MONITOR_NEON)
+	return _audio_monitor_true_peak_neon;
+#else
+	return _audio_monitor_true_peak_c;
+#endif
+}
+
+// interpolate each sink in chunks behind its last frames, sample peaks as marker
+static void
+_audio_monitor_true_peaks(monitor_app_t *monitor, monitor_meter_t *meters,
+	const float *const *psinks, unsigned nlanes, jack_nframes_t nframes,
+	float levels [MONITOR_SLOTS][MONITOR_GROUPS*MONITOR_LANES])
+{
+	float window [MONITOR_TAPS - 1 + MONITOR_CHUNK];
+
+	for(unsigned i = 0; i < nlanes; i++)
+	{
+		const unsigned l = i % MONITOR_LANES;
+		float *taps = meters[i / MONITOR_LANES].taps[l];
+		const float *psink = psinks[i];
+		float peak = 0.f;
+
+		if(l == 0)
+		{
+			monitor_stats_t stats;
+
+			memset(&stats, 0x0, sizeof(stats));
+			monitor->scan(&psinks[i], nframes, &stats);
+
+			for(unsigned j = 0; j < MONITOR_LANES; j++)
+				levels[1][i + j] = _audio_monitor_stats_peak(&stats, j);
+		}
+
+		memcpy(window, taps, sizeof(meters->taps[l]));
+
+		for(jack_nframes_t offset = 0; offset < nframes; )
+		{
+			jack_nframes_t n = nframes - offset;
+			if(n > MONITOR_CHUNK)
+				n = MONITOR_CHUNK;
+
+			memcpy(&window[MONITOR_TAPS - 1], &psink[offset], n*sizeof(float));
+			peak = monitor->true_peak(window, n, peak);
+			memmove(window, &window[n], sizeof(meters->taps[l]));
+
+			offset += n;
+		}
+
+		memcpy(taps, window, sizeof(meters->taps[l]));
+		levels[0][i] = peak;
+	}
+}
+
+// close current block and slide windows over it
+static void
+_audio_monitor_meter_push(monitor_meter_t *meter, const unsigned *windows,
+	jack_nframes_t block, unsigned head)
+{
+	const float norm = 1.f / block;
+
+	for(unsigned l = 0; l < MONITOR_LANES; l++)
+	{
+		const float ms = meter->sum[l] * norm;
+
+		for(unsigned s = 0; s < MONITOR_SLOTS; s++)
+		{
+			if(!windows[s])
+				continue;
+
+			const unsigned tail = (head + MONITOR_BLOCKS - windows[s]) % MONITOR_BLOCKS;
+			meter->windows[s][l] += ms - meter->blocks[tail][l];
+		}
+
+		meter->blocks[head][l] = ms;
+		meter->sum[l] = 0.f;
+	}
+
+	if(head != MONITOR_BLOCKS - 1)
+		return;
+
+	// sum up anew once per round, so that rounding errors do not pile up
+	for(unsigned s = 0; s < MONITOR_SLOTS; s++)
+	{
+		for(unsigned l = 0; l < MONITOR_LANES; l++)
+		{
+			float sum = 0.f;
+
+			for(unsigned b = MONITOR_BLOCKS - windows[s]; b < MONITOR_BLOCKS; b++)
+				sum += meter->blocks[b][l];
+
+			meter->windows[s][l] = sum;
+		}
+	}
+}
+
+// integrate groups of sinks over cycle, split at block boundaries
+static void
+_audio_monitor_meter(monitor_app_t *monitor, monitor_meter_t *meters,
+	const float *const *psinks, jack_nframes_t nframes,
+	float levels [MONITOR_SLOTS][MONITOR_GROUPS*MONITOR_LANES])
+{
+	const unsigned *windows = monitor_windows[monitor->mode];
+	jack_nframes_t fill = monitor->fill;
+	unsigned head = monitor->head;
+
+	for(jack_nframes_t offset = 0; offset < nframes; )
+	{
+		jack_nframes_t n = monitor->block - fill;
+		if(n > nframes - offset)
+			n = nframes - offset;
+
+		if(monitor->mode == MONITOR_LUFS)
+			monitor->kweights(meters, &monitor->kweight, psinks, offset, n);
+		else
+		{
+			for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+				_audio_monitor_rms(monitor, &meters[g], &psinks[g*MONITOR_LANES], offset, n);
+		}
+
+		offset += n;
+		fill += n;
+
+		if(fill == monitor->block)
+		{
+			for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+				_audio_monitor_meter_push(&meters[g], windows, monitor->block, head);
+
+			fill = 0;
+			head = (head + 1) % MONITOR_BLOCKS;
+		}
+	}
+
+	for(unsigned g = 0; g < MONITOR_GROUPS; g++)
+	{
+		monitor_meter_t *meter = &meters[g];
+
+		for(unsigned s = 0; s < MONITOR_SLOTS; s++)
+		{
+			for(unsigned l = 0; l < MONITOR_LANES; l++)
+			{
+				const float mean = windows[s]
+					? meter->windows[s][l] / windows[s]
+					: meter->peak[l];
+
+				levels[s][g*MONITOR_LANES + l] = (mean > 0.f) ? mean : 0.f;
+			}
+		}
+
+		memset(meter->peak, 0x0, sizeof(meter->peak));
+	}
+}
+
+static inline void
+_audio_monitor_meter_advance(monitor_app_t *monitor, jack_nframes_t nframes)
+{
+	const jack_nframes_t fill = monitor->fill + nframes;
+
+	monitor->head = (monitor->head + fill / monitor->block) % MONITOR_BLOCKS;
+	monitor->fill = fill % monitor->block;
+}
+
+// scan group of sinks split at history entries, extremes of whole cycle into cycle
+static void
+_audio_monitor_history(monitor_app_t *monitor, monitor_shm_t *shm, unsigned base,
+	const float *const *psinks, jack_nframes_t nframes, monitor_stats_t *cycle)
+{
+	monitor_stats_t *stats = &monitor->stats[base / MONITOR_LANES];
+	const unsigned nsinks = monitor->nsinks;
+	jack_nframes_t fill = monitor->hfill;
+	uint32_t head = monitor->hhead;
+	const float *pspans [MONITOR_LANES];
+
+	_audio_monitor_stats_reset(cycle);
+
+	for(jack_nframes_t offset = 0; offset < nframes; )
+	{
+		jack_nframes_t n = monitor->hblock - fill;
+		if(n > nframes - offset)
+			n = nframes - offset;
+
+		monitor_stats_t span;
+		_audio_monitor_stats_reset(&span);
+
+		for(unsigned l = 0; l < MONITOR_LANES; l++)
+			pspans[l] = &psinks[l][offset];
+
+		monitor->scan(pspans, n, &span);
+		_audio_monitor_stats_merge(cycle, &span);
+		_audio_monitor_stats_merge(stats, &span);
+
+		offset += n;
+		fill += n;
+
+		if(fill == monitor->hblock)
+		{
+			const float norm = 1.f / monitor->hblock;
+
+			for(unsigned l = 0; (l < MONITOR_LANES) && (base + l < nsinks); l++)
+			{
+				monitor_history_t *entry = &_monitor_shm_history(shm, nsinks, base + l)[
+					head % MONITOR_HISTORY];
+
+				entry->min = stats->min[l];
+				entry->max = stats->max[l];
+				entry->rms = sqrtf(stats->sum[l] * norm);
+			}
+
+			_audio_monitor_stats_reset(stats);
+			fill = 0;
+			head++;
+		}
+	}
+}
+
+// publish entries written in this cycle
+static inline void
+_audio_monitor_history_advance(monitor_app_t *monitor, monitor_shm_t *shm,
+	jack_nframes_t nframes)
+{
+	const jack_nframes_t fill = monitor->hfill + nframes;
+
+	monitor->hhead += fill / monitor->hblock;
+	monitor->hfill = fill % monitor->hblock;
+
+	atomic_store_explicit(&shm->history, monitor->hhead, memory_order_release);
+}
+
+static void
+_monitor_stats_clear(monitor_stats_t *stats, unsigned l)
+{
+	stats->min[l] = FLT_MAX;
+	stats->max[l] = -FLT_MAX;
+	stats->sum[l] = 0.f;
+}
+
+static void
+_monitor_meter_clear(monitor_meter_t *meter, unsigned l)
+{
+	for(unsigned z = 0; z < 4; z++)
+		meter->z[z][l] = 0.f;
+
+	meter->sum[l] = 0.f;
+	meter->peak[l] = 0.f;
+
+	for(unsigned b = 0; b < MONITOR_BLOCKS; b++)
+		meter->blocks[b][l] = 0.f;
+
+	for(unsigned s = 0; s < MONITOR_SLOTS; s++)
+		meter->windows[s][l] = 0.f;
+
+	for(unsigned j = 0; j < MONITOR_TAPS - 1; j++)
+		meter->taps[l][j] = 0.f;
+}
+
+// carry integrated loudness, current history entry and block of kept sinks over to resized state
+static void
+_monitor_meters_copy(monitor_app_t *dst, const monitor_app_t *src)
+{
+	const bool metered = _monitor_mode_metered(dst->mode);
+	const unsigned dgroups = _monitor_groups(dst->nsinks);
+	const unsigned sgroups = _monitor_groups(src->nsinks);
+	const unsigned ngroups = dgroups < sgroups ? dgroups : sgroups;
+
+	memcpy(dst->stats, src->stats, ngroups*sizeof(monitor_stats_t));
+	if(metered)
+		memcpy(dst->meters, src->meters, ngroups*sizeof(monitor_meter_t));
+	if(_monitor_is_cv(dst))
+		memcpy(dst->blocks, src->blocks,
+			(dst->nsinks < src->nsinks ? dst->nsinks : src->nsinks)*sizeof(monitor_block_t));
+
+	// lanes past old sinks did repeat last one
+	for(unsigned i = src->nsinks; i < ngroups*MONITOR_LANES; i++)
+	{
+		_monitor_stats_clear(&dst->stats[i / MONITOR_LANES], i % MONITOR_LANES);
+		if(metered)
+			_monitor_meter_clear(&dst->meters[i / MONITOR_LANES], i % MONITOR_LANES);
+	}
+}
+
+static void
+_audio_monitor_correlate_c(const float *left, const float *right,
+	jack_nframes_t nframes, float sums [3])
+{
+	float ll = 0.f;
+	float rr = 0.f;
+	float lr = 0.f;
+
+	for(unsigned k = 0; k < nframes; k++)
+	{
+		ll += left[k] * left[k];
+		rr += right[k] * right[k];
+		lr += left[k] * right[k];
+	}
+
+	sums[0] += ll;
+	sums[1] += rr;
+	sums[2] += lr;
+}
+
+#if defined(MONITOR_SSE)
+static inline float
+_audio_monitor_sum_sse(__m128 x)
+{
+	x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+	x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 0x55));
+
+	return _mm_cvtss_f32(x);
+}
+
+// remaining frames into running vectors, then into sums
+static inline void
+_audio_monitor_correlate_tail_sse(__m128 ll, __m128 rr, __m128 lr,
+	const float *left, const float *right, unsigned k, jack_nframes_t nframes,
+	float sums [3])
+{
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const __m128 l = _mm_loadu_ps(&left[k]);
+		const __m128 r = _mm_loadu_ps(&right[k]);
+
+		ll = _mm_add_ps(_mm_mul_ps(l, l), ll);
+		rr = _mm_add_ps(_mm_mul_ps(r, r), rr);
+		lr = _mm_add_ps(_mm_mul_ps(l, r), lr);
+	}
+
+	for( ; k < nframes; k++)
+	{
+		const __m128 l = _mm_load_ss(&left[k]);
+		const __m128 r = _mm_load_ss(&right[k]);
+
+		ll = _mm_add_ss(ll, _mm_mul_ss(l, l));
+		rr = _mm_add_ss(rr, _mm_mul_ss(r, r));
+		lr = _mm_add_ss(lr, _mm_mul_ss(l, r));
+	}
+
+	sums[0] += _audio_monitor_sum_sse(ll);
+	sums[1] += _audio_monitor_sum_sse(rr);
+	sums[2] += _audio_monitor_sum_sse(lr);
+}
+
+static void
+_audio_monitor_correlate_sse(const float *left, const float *right,
+	jack_nframes_t nframes, float sums [3])
+{
+	const __m128 zero = _mm_setzero_ps();
+
+	_audio_monitor_correlate_tail_sse(zero, zero, zero, left, right, 0, nframes, sums);
+}
+#endif
+
+#if defined(MONITOR_AVX)
+__attribute__((target("avx")))
+static void
+_audio_monitor_correlate_avx(const float *left, const float *right,
+	jack_nframes_t nframes, float sums [3])
+{
+	__m256 ll = _mm256_setzero_ps();
+	__m256 rr = _mm256_setzero_ps();
+	__m256 lr = _mm256_setzero_ps();
+	unsigned k = 0;
+
+	for( ; k + 8 <= nframes; k += 8)
+	{
+		const __m256 l = _mm256_loadu_ps(&left[k]);
+		const __m256 r = _mm256_loadu_ps(&right[k]);
+
+		ll = _mm256_add_ps(_mm256_mul_ps(l, l), ll);
+		rr = _mm256_add_ps(_mm256_mul_ps(r, r), rr);
+		lr = _mm256_add_ps(_mm256_mul_ps(l, r), lr);
+	}
+
+	// fold halves, remaining frames go through SSE tail
+	_audio_monitor_correlate_tail_sse(
+		_mm_add_ps(_mm256_castps256_ps128(ll), _mm256_extractf128_ps(ll, 1)),
+		_mm_add_ps(_mm256_castps256_ps128(rr), _mm256_extractf128_ps(rr, 1)),
+		_mm_add_ps(_mm256_castps256_ps128(lr), _mm256_extractf128_ps(lr, 1)),
+		left, right, k, nframes, sums);
+}
+#endif
+
+#if defined(MONITOR_NEON)
+static void
+_audio_monitor_correlate_neon(const float *left, const float *right,
+	jack_nframes_t nframes, float sums [3])
+{
+	float32x4_t ll = vdupq_n_f32(0.f);
+	float32x4_t rr = vdupq_n_f32(0.f);
+	float32x4_t lr = vdupq_n_f32(0.f);
+	unsigned k = 0;
+
+	for( ; k + 4 <= nframes; k += 4)
+	{
+		const float32x4_t l = vld1q_f32(&left[k]);
+		const float32x4_t r = vld1q_f32(&right[k]);
+
+		ll = vmlaq_f32(ll, l, l);
+		rr = vmlaq_f32(rr, r, r);
+		lr = vmlaq_f32(lr, l, r);
+	}
+
+	sums[0] += vaddvq_f32(ll);
+	sums[1] += vaddvq_f32(rr);
+	sums[2] += vaddvq_f32(lr);
+
+	_audio_monitor_correlate_c(&left[k], &right[k], nframes - k, sums);
+}
+#endif
+
+static monitor_correlate_t
+_audio_monitor_correlate_select(void)
+{
+#if defined(MONITOR_AVX)
+	if(__builtin_cpu_supports("avx"))
+		return _audio_monitor_correlate_avx;
+#endif
+#if defined(MONITOR_SSE)
+	return _audio_monitor_correlate_sse;
+#elif defined(MONITOR_NEON)
+	return _audio_monitor_correlate_neon;
+#else
+	return _audio_monitor_correlate_c;
+#endif
+}
+
+// correlation coefficient and balance of a whole block
+static void
+_audio_monitor_pair_push(monitor_pair_t *pair, const float sums [3], jack_nframes_t block)
+{
+	const float ll = sums[0];
+	const float rr = sums[1];
+	const float lr = sums[2];
+
+	if(ll + rr < block*MONITOR_SILENCE)
+	{
+		pair->correlation = 0.f;
+		pair->balance = 0.f;
+		return;
+	}
+
+	const float norm = sqrtf(ll * rr);
+	const float correlation = (norm > 0.f) ? lr / norm : 0.f;
+
+	pair->correlation = (correlation > 1.f) ? 1.f : (correlation < -1.f) ? -1.f : correlation;
+	pair->balance = (rr - ll) / (rr + ll);
+}
+
+// integrate pairs of sinks over blocks, goniometer points every few frames
+static void
+_audio_monitor_correlation(monitor_app_t *monitor, monitor_shm_t *shm,
+	jack_nframes_t nframes)
+{
+	const unsigned nsinks = monitor->nsinks;
+	const unsigned npoints = (monitor->phase < nframes)
+		? (nframes - monitor->phase + MONITOR_DECIMATE - 1) / MONITOR_DECIMATE
+		: 0;
+
+	for(unsigned p = 0; p < monitor->ncorrs; p++)
+	{
+		monitor_corr_t *corr = &monitor->corrs[p];
+		monitor_pair_t *pair = _monitor_shm_pair(shm, nsinks, p);
+		const float *left = jack_port_get_buffer(monitor->jsinks[corr->left], nframes);
+		const float *right = jack_port_get_buffer(monitor->jsinks[corr->right], nframes);
+		jack_nframes_t fill = monitor->fill;
+
+		for(jack_nframes_t offset = 0; offset < nframes; )
+		{
+			jack_nframes_t n = monitor->block - fill;
+			if(n > nframes - offset)
+				n = nframes - offset;
+
+			monitor->correlate(&left[offset], &right[offset], n, corr->sums);
+
+			offset += n;
+			fill += n;
+
+			if(fill == monitor->block)
+			{
+				_audio_monitor_pair_push(pair, corr->sums, monitor->block);
+				memset(corr->sums, 0x0, sizeof(corr->sums));
+				fill = 0;
+			}
+		}
+
+		for(unsigned j = 0; j < npoints; j++)
+		{
+			const jack_nframes_t k = monitor->phase + j*MONITOR_DECIMATE;
+			float *point = pair->points[(monitor->point + j) % MONITOR_POINTS];
+
+			point[0] = left[k];
+			point[1] = right[k];
+		}
+	}
+
+	monitor->point += npoints;
+	monitor->phase = monitor->phase + npoints*MONITOR_DECIMATE - nframes;
+}
+
+// twiddles, bit reversal, window and bands of bins, once per worker
+static void
+_monitor_spectrum_init(monitor_spectrum_t *spectrum, jack_nframes_t sample_rate)
+{
+	const unsigned nbins = MONITOR_FFT/2;
+	const double df = (double)sample_rate / MONITOR_FFT;
+	const double ratio = log((sample_rate / 2.0) / MONITOR_FLOOR) / MONITOR_BANDS;
+	unsigned bits = 0;
+
+	while((1u << bits) < nbins)
+		bits++;
+
+	for(unsigned n = 0; n < MONITOR_FFT; n++)
+		spectrum->window[n] = 0.5 - 0.5*cos(2.0*M_PI*n / MONITOR_FFT);
+
+	for(unsigned k = 0; k < nbins; k++)
+	{
+		unsigned rev = 0;
+
+		for(unsigned b = 0; b < bits; b++)
+			rev |= ((k >> b) & 1) << (bits - 1 - b);
+
+		spectrum->rev[k] = rev;
+		spectrum->cos[k] = cos(2.0*M_PI*k / MONITOR_FFT);
+		spectrum->sin[k] = -sin(2.0*M_PI*k / MONITOR_FFT);
+	}
+
+	for(unsigned b = 0; b < MONITOR_BANDS; b++)
+	{
+		const double f0 = MONITOR_FLOOR * exp(ratio*b);
+		const double f1 = MONITOR_FLOOR * exp(ratio*(b + 1));
+		unsigned lo = ceil(f0 / df);
+		unsigned hi = ceil(f1 / df);
+
+		if(hi > nbins)
+			hi = nbins;
+
+		if(lo >= hi) // narrower than a bin, take the one nearest to its center
+		{
+			lo = lround(sqrt(f0*f1) / df);
+			if(lo >= nbins)
+				lo = nbins - 1;
+			hi = lo + 1;
+		}
+
+		spectrum->lo[b] = lo;
+		spectrum->hi[b] = hi;
+	}
+}
+
+// in-place radix-2 transform of MONITOR_FFT/2 complex values
+static void
+_monitor_fft(const monitor_spectrum_t *spectrum, float *re, float *im)
+{
+	const unsigned n = MONITOR_FFT/2;
+
+	for(unsigned k = 0; k < n; k++)
+	{
+		const unsigned j = spectrum->rev[k];
+
+		if(k < j)
+		{
+			const float r = re[k];
+			const float i = im[k];
+
+			re[k] = re[j];
+			im[k] = im[j];
+			re[j] = r;
+			im[j] = i;
+		}
+	}
+
+	for(unsigned len = 2; len <= n; len <<= 1)
+	{
+		const unsigned half = len / 2;
+		const unsigned step = MONITOR_FFT / len;
+
+		for(unsigned s = 0; s < n; s += len)
+		{
+			for(unsigned j = 0; j < half; j++)
+			{
+				const float wr = spectrum->cos[j*step];
+				const float wi = spectrum->sin[j*step];
+				const unsigned a = s + j;
+				const unsigned b = a + half;
+				const float tr = re[b]*wr - im[b]*wi;
+				const float ti = re[b]*wi + im[b]*wr;
+
+				re[b] = re[a] - tr;
+				im[b] = im[a] - ti;
+				re[a] += tr;
+				im[a] += ti;
+			}
+		}
+	}
+}
+
+// windowed real transform of a sink's ring, as peak amplitude per band
+static void
+_monitor_spectrum_transform(monitor_spectrum_t *spectrum, const float *buf)
+{
+	const unsigned n = MONITOR_FFT/2;
+	float *re = spectrum->re;
+	float *im = spectrum->im;
+
+	// even frames as real, odd ones as imaginary parts, half as long a transform
+	for(unsigned k = 0; k < n; k++)
+	{
+		const unsigned e = 2*k;
+		const unsigned o = 2*k + 1;
+
+		re[k] = buf[(spectrum->pos + e) % MONITOR_FFT] * spectrum->window[e];
+		im[k] = buf[(spectrum->pos + o) % MONITOR_FFT] * spectrum->window[o];
+	}
+
+	_monitor_fft(spectrum, re, im);
+
+	// Hann has coherent gain of 1/2, so that a full-scale sine reads as 1
+	const float norm = 4.f / MONITOR_FFT;
+
+	for(unsigned k = 0; k < n; k++)
+	{
+		// untangle spectra of even and odd frames
+		const unsigned m = (n - k) % n;
+		const float er = 0.5f*(re[k] + re[m]);
+		const float ei = 0.5f*(im[k] - im[m]);
+		const float dr = 0.5f*(im[k] + im[m]);
+		const float di = -0.5f*(re[k] - re[m]);
+		const float xr = er + dr*spectrum->cos[k] - di*spectrum->sin[k];
+		const float xi = ei + dr*spectrum->sin[k] + di*spectrum->cos[k];
+
+		spectrum->amps[k] = sqrtf(xr*xr + xi*xi) * norm;
+	}
+
+	// bands may share bins where they are narrower than one
+	for(unsigned b = 0; b < MONITOR_BANDS; b++)
+	{
+		float amp = 0.f;
+
+		for(unsigned k = spectrum->lo[b]; k < spectrum->hi[b]; k++)
+		{
+			if(spectrum->amps[k] > amp)
+				amp = spectrum->amps[k];
+		}
+
+		spectrum->bands[b] = amp;
+	}
+}
+
+// transform all sinks and publish them under seqlock of shm
+static void
+_monitor_spectrum_publish(monitor_spectrum_t *spectrum)
+{
+	pthread_mutex_lock(&spectrum->lock);
+
+	monitor_shm_t *shm = spectrum->shm;
+	const unsigned nsinks = spectrum->nsinks < spectrum->nbufs
+		? spectrum->nsinks
+		: spectrum->nbufs;
+	const uint32_t seq = atomic_load_explicit(&shm->spectrum, memory_order_relaxed);
+
+	atomic_store_explicit(&shm->spectrum, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		_monitor_spectrum_transform(spectrum, &spectrum->bufs[i*MONITOR_FFT]);
+		memcpy(_monitor_shm_spectrum(shm, spectrum->nsinks, i), spectrum->bands,
+			sizeof(spectrum->bands));
+	}
+
+	atomic_store_explicit(&shm->spectrum, seq + 2, memory_order_release);
+
+	pthread_mutex_unlock(&spectrum->lock);
+}
+
+// append cycle to rings, transform every hop
+static int
+_monitor_spectrum_feed(monitor_spectrum_t *spectrum, const monitor_chunk_t *chunk)
+{
+	if(chunk->nsinks != spectrum->nbufs)
+	{
+		float *bufs = realloc(spectrum->bufs, (chunk->nsinks ? chunk->nsinks : 1)
+			* MONITOR_FFT*sizeof(float));
+		if(!bufs)
+			return -1;
+
+		for(unsigned i = spectrum->nbufs; i < chunk->nsinks; i++)
+			memset(&bufs[i*MONITOR_FFT], 0x0, MONITOR_FFT*sizeof(float));
+
+		spectrum->bufs = bufs;
+		spectrum->nbufs = chunk->nsinks;
+	}
+
+	for(jack_nframes_t offset = 0; offset < chunk->nframes; )
+	{
+		// up to next transform or wrap of rings, whatever comes first
+		jack_nframes_t n = chunk->nframes - offset;
+		if(n > MONITOR_HOP - spectrum->fill)
+			n = MONITOR_HOP - spectrum->fill;
+		if(n > MONITOR_FFT - spectrum->pos)
+			n = MONITOR_FFT - spectrum->pos;
+
+		for(unsigned i = 0; i < spectrum->nbufs; i++)
+		{
+			memcpy(&spectrum->bufs[i*MONITOR_FFT + spectrum->pos],
+				&chunk->frames[i*chunk->nframes + offset], n*sizeof(float));
+		}
+
+		offset += n;
+		spectrum->pos = (spectrum->pos + n) % MONITOR_FFT;
+		spectrum->fill += n;
+
+		if(spectrum->fill == MONITOR_HOP)
+		{
+			_monitor_spectrum_publish(spectrum);
+			spectrum->fill = 0;
+		}
+	}
+
+	return 0;
+}
+
+static void *
+_monitor_spectrum_worker(void *data)
+{
+	monitor_spectrum_t *spectrum = data;
+
+	while(!atomic_load_explicit(&spectrum->quit, memory_order_acquire))
+	{
+		sem_wait(&spectrum->wake);
+
+		const monitor_chunk_t *chunk;
+		size_t len;
+
+		while((chunk = varchunk_read_request(spectrum->rx, &len)))
+		{
+			if(_monitor_spectrum_feed(spectrum, chunk) == -1)
+				fprintf(stderr, "failed to buffer spectrum\n");
+
+			varchunk_read_advance(spectrum->rx);
+		}
+	}
+
+	return NULL;
+}
+
+// hand cycle over to spectrum worker, copying is all the RT thread does for it
+static void
+_audio_monitor_spectrum_push(monitor_app_t *monitor, jack_nframes_t nframes)
+{
+	monitor_spectrum_t *spectrum = monitor->spectrum;
+	const unsigned nsinks = monitor->nsinks;
+	const size_t size = sizeof(monitor_chunk_t) + nsinks*nframes*sizeof(float);
+
+	monitor_chunk_t *chunk = varchunk_write_request(spectrum->rx, size);
+	if(!chunk) // worker lags behind, drop cycle
+		return;
+
+	chunk->nsinks = nsinks;
+	chunk->nframes = nframes;
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		memcpy(&chunk->frames[i*nframes], jack_port_get_buffer(monitor->jsinks[i], nframes),
+			nframes*sizeof(float));
+	}
+
+	varchunk_write_advance(spectrum->rx, size);
+	sem_post(&spectrum->wake);
+}
+
+static int
+_monitor_spectrum_start(monitor_app_t *monitor, jack_nframes_t sample_rate)
+{
+	monitor_spectrum_t *spectrum = calloc(1, sizeof(monitor_spectrum_t));
+	if(!spectrum)
+		return -1;
+
+	if(!(spectrum->rx = varchunk_new(MONITOR_SPECTRUM_SIZE, true)))
+	{
+		free(spectrum);
+		return -1;
+	}
+
+	_monitor_spectrum_init(spectrum, sample_rate);
+	spectrum->shm = monitor->shm;
+	spectrum->nsinks = monitor->nsinks;
+	atomic_init(&spectrum->quit, false);
+	atomic_init(&spectrum->shm->spectrum, 0);
+	memset(_monitor_shm_spectrum(spectrum->shm, spectrum->nsinks, 0), 0x0,
+		spectrum->nsinks*MONITOR_BANDS*sizeof(float));
+
+	if(sem_init(&spectrum->wake, 0, 0) == -1)
+	{
+		varchunk_free(spectrum->rx);
+		free(spectrum);
+		return -1;
+	}
+
+	pthread_mutex_init(&spectrum->lock, NULL);
+
+	if(pthread_create(&spectrum->thread, NULL, _monitor_spectrum_worker, spectrum) != 0)
+	{
+		pthread_mutex_destroy(&spectrum->lock);
+		sem_destroy(&spectrum->wake);
+		varchunk_free(spectrum->rx);
+		free(spectrum);
+		return -1;
+	}
+
+	monitor->spectrum = spectrum;
+
+	return 0;
+}
+
+// call once process callback does not run any more
+static void
+_monitor_spectrum_stop(monitor_app_t *monitor)
+{
+	monitor_spectrum_t *spectrum = monitor->spectrum;
+
+	if(!spectrum)
+		return;
+
+	atomic_store_explicit(&spectrum->quit, true, memory_order_release);
+	sem_post(&spectrum->wake);
+	pthread_join(spectrum->thread, NULL);
+
+	pthread_mutex_destroy(&spectrum->lock);
+	sem_destroy(&spectrum->wake);
+	varchunk_free(spectrum->rx);
+	free(spectrum->bufs);
+	free(spectrum);
+	monitor->spectrum = NULL;
+}
+
+static atomic_bool monitor_closed = ATOMIC_VAR_INIT(false);
+
+static inline void *
+_monitor_carve(uint8_t *mem, size_t *offset, size_t size)
+{
+	void *ptr = mem ? mem + *offset : NULL;
+
+	// keep every array on its own cache lines
+	*offset += (size + SHM_CACHE_LINE - 1) & ~(size_t)(SHM_CACHE_LINE - 1);
+
+	return ptr;
+}
+
+static inline size_t
+_monitor_app_layout(monitor_app_t *monitor, uint8_t *mem)
+{
+	const size_t nsinks = monitor->nsinks;
+	size_t offset = 0;
+
+	monitor->jsinks = _monitor_carve(mem, &offset, nsinks*sizeof(jack_port_t *));
+	monitor->meters = _monitor_carve(mem, &offset, _monitor_mode_metered(monitor->mode)
+		? _monitor_groups(nsinks)*sizeof(monitor_meter_t) : 0);
+	monitor->stats = _monitor_carve(mem, &offset, _monitor_groups(nsinks)*sizeof(monitor_stats_t));
+	monitor->corrs = _monitor_carve(mem, &offset, monitor->mode == MONITOR_CORRELATION
+		? nsinks/2*sizeof(monitor_corr_t) : 0);
+	monitor->blocks = _monitor_carve(mem, &offset, _monitor_is_cv(monitor)
+		? nsinks*sizeof(monitor_block_t) : 0);
+
+	return offset;
+}
+
+static int
+_monitor_app_alloc(monitor_app_t *monitor, unsigned nsinks)
+{
+	monitor->nsinks = nsinks;
+	monitor->mem_size = _monitor_app_layout(monitor, NULL);
+
+	if(posix_memalign(&monitor->mem, SHM_CACHE_LINE, monitor->mem_size) != 0)
+	{
+		monitor->mem = NULL;
+		return -1;
+	}
+
+	memset(monitor->mem, 0x0, monitor->mem_size);
+	_monitor_app_layout(monitor, monitor->mem);
+
+	for(unsigned g = 0; g < _monitor_groups(nsinks); g++)
+		_audio_monitor_stats_reset(&monitor->stats[g]);
+	monitor->scan = _audio_monitor_scan_select();
+	monitor->kweights = _audio_monitor_kweights_select();
+	monitor->true_peak = _audio_monitor_true_peak_select();
+	monitor->correlate = _audio_monitor_correlate_select();
+
+	// keep RT thread off page faults, best effort within RLIMIT_MEMLOCK
+	mlock(monitor->mem, monitor->mem_size);
+
+	return 0;
+}
+
+static void
+_monitor_app_free(monitor_app_t *monitor)
+{
+	if(!monitor->mem)
+		return;
+
+	munlock(monitor->mem, monitor->mem_size);
+	free(monitor->mem);
+	monitor->mem = NULL;
+}
+
+static void
+_monitor_app_swap(monitor_app_t *monitor, monitor_app_t *next)
+{
+#define MONITOR_SWAP(FIELD) \
+	do { \
+		__typeof__(monitor->FIELD) tmp = monitor->FIELD; \
+		monitor->FIELD = next->FIELD; \
+		next->FIELD = tmp; \
+	} while(0)
+
+	MONITOR_SWAP(jsinks);
+	MONITOR_SWAP(meters);
+	MONITOR_SWAP(stats);
+	MONITOR_SWAP(corrs);
+	MONITOR_SWAP(blocks);
+	MONITOR_SWAP(nsinks);
+	MONITOR_SWAP(ncorrs);
+	MONITOR_SWAP(mem);
+	MONITOR_SWAP(mem_size);
+	MONITOR_SWAP(shm);
+
+#undef MONITOR_SWAP
+}
+
+static void
+_monitor_sync_handle(monitor_app_t *monitor)
+{
+	int state = atomic_load_explicit(&monitor->sync, memory_order_acquire);
+
+	switch(state)
+	{
+		case SYNC_NONE:
+		{
+			monitor->frozen = false;
+		} break;
+		case SYNC_FREEZE:
+		{
+			// main thread may have given up waiting in the meantime
+			monitor->frozen = atomic_compare_exchange_strong_explicit(&monitor->sync,
+				&state, SYNC_FROZEN, memory_order_acq_rel, memory_order_acquire);
+		} break;
+		case SYNC_FROZEN:
+		{
+			monitor->frozen = true;
+		} break;
+		case SYNC_SWAP:
+		{
+			_monitor_app_swap(monitor, monitor->next);
+			monitor->frozen = false;
+
+			atomic_store_explicit(&monitor->sync, SYNC_NONE, memory_order_release);
+		} break;
+	}
+}
+
+static inline const char *
+_monitor_group(monitor_app_t *monitor)
+{
+	return monitor->hosted ? monitor->name : NULL;
+}
+
+static jack_port_t *
+_monitor_sink_register(monitor_app_t *monitor, unsigned i)
+{
+	char buf [32];
+	snprintf(buf, 32, "sink_%02u", i + 1);
+
+	const bool is_signal = (monitor->type == TYPE_AUDIO) || _monitor_is_cv(monitor);
+
+	jack_port_t *jsink = _group_port_register(monitor->client, _monitor_group(monitor), buf,
+		is_signal ? JACK_DEFAULT_AUDIO_TYPE : JACK_DEFAULT_MIDI_TYPE,
+		JackPortIsInput | JackPortIsTerminal);
+	if(!jsink)
+		return NULL;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(jsink);
+
+	snprintf(buf, 32, "%u", i);
+	jack_set_property(monitor->client, uuid, JACKEY_ORDER, buf, XSD__integer);
+
+	if(monitor->type == TYPE_MIDI)
+		jack_set_property(monitor->client, uuid, JACKEY_EVENT_TYPES, "MIDI", "text/plain");
+	else if(monitor->type == TYPE_OSC)
+		jack_set_property(monitor->client, uuid, JACKEY_EVENT_TYPES, "OSC", "text/plain");
+	else if(monitor->type == TYPE_CV)
+		jack_set_property(monitor->client, uuid, JACKEY_SIGNAL_TYPE, "CV", "text/plain");
+
+	snprintf(buf, 32, "Sink %u", i + 1);
+	jack_set_property(monitor->client, uuid, JACK_METADATA_PRETTY_NAME, buf, "text/plain");
+#endif
+
+	return jsink;
+}
+
+static void
+_monitor_port_unregister(monitor_app_t *monitor, jack_port_t *port)
+{
+	if(!port)
+		return;
+
+#ifdef JACK_HAS_METADATA_API
+	jack_uuid_t uuid = jack_port_uuid(port);
+	jack_remove_properties(monitor->client, uuid);
+#endif
+	jack_port_unregister(monitor->client, port);
+}
+
+// designation of sink, else of first port connected to it
+static port_designation_t
+_monitor_sink_designation(monitor_app_t *monitor, jack_port_t *jsink)
+{
+	port_designation_t designation = DESIGNATION_NONE;
+
+#ifdef JACK_HAS_METADATA_API
+	char *value = NULL;
+	char *type = NULL;
+
+	if(jack_get_property(jack_port_uuid(jsink), JACK_METADATA_PORT_GROUP, &value, &type) != 0)
+	{
+		value = NULL;
+
+		const char **conns = jack_port_get_connections(jsink);
+		if(conns)
+		{
+			jack_port_t *jsource = jack_port_by_name(monitor->client, conns[0]);
+
+			if(  jsource && (jack_get_property(jack_port_uuid(jsource),
+				JACK_METADATA_PORT_GROUP, &value, &type) != 0) )
+			{
+				value = NULL;
+			}
+
+			jack_free(conns);
+		}
+	}
+
+	if(value)
+	{
+		designation = _designation_get(value);
+
+		jack_free(value);
+		if(type)
+			jack_free(type);
+	}
+#endif
+
+	return designation;
+}
+
+// left and right by designation first, undesignated sinks by adjacent index
+static unsigned
+_monitor_pairs_find(monitor_app_t *monitor, jack_port_t **jsinks, unsigned nsinks,
+	monitor_corr_t *corrs)
+{
+	static const port_designation_t partners [DESIGNATION_MAX] = {
+		[DESIGNATION_LEFT] = DESIGNATION_RIGHT,
+		[DESIGNATION_CENTER_LEFT] = DESIGNATION_CENTER_RIGHT,
+		[DESIGNATION_SIDE_LEFT] = DESIGNATION_SIDE_RIGHT,
+		[DESIGNATION_REAR_LEFT] = DESIGNATION_REAR_RIGHT
+	};
+	port_designation_t designations [PORT_MAX];
+	bool paired [PORT_MAX] = { false };
+	unsigned npairs = 0;
+
+	for(unsigned i = 0; i < nsinks; i++)
+		designations[i] = _monitor_sink_designation(monitor, jsinks[i]);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		const port_designation_t partner = partners[designations[i]];
+
+		if(partner == DESIGNATION_NONE)
+			continue;
+
+		for(unsigned j = 0; j < nsinks; j++)
+		{
+			if(paired[j] || (designations[j] != partner))
+				continue;
+
+			corrs[npairs++] = (monitor_corr_t){ .left = i, .right = j };
+			paired[i] = paired[j] = true;
+			break;
+		}
+	}
+
+	for(unsigned i = 0, left = nsinks; i < nsinks; i++)
+	{
+		if(paired[i] || (designations[i] != DESIGNATION_NONE))
+			continue;
+
+		if(left == nsinks)
+		{
+			left = i;
+			continue;
+		}
+
+		corrs[npairs++] = (monitor_corr_t){ .left = left, .right = i };
+		left = nsinks;
+	}
+
+	return npairs;
+}
+
+// RT thread is frozen or not yet running
+static void
+_monitor_pairs_publish(monitor_shm_t *shm, unsigned nsinks,
+	const monitor_corr_t *corrs, unsigned npairs)
+{
+	for(unsigned p = 0; p < nsinks/2; p++)
+	{
+		monitor_pair_t *pair = _monitor_shm_pair(shm, nsinks, p);
+
+		memset(pair, 0x0, sizeof(*pair));
+
+		if(p < npairs)
+		{
+			pair->left = corrs[p].left;
+			pair->right = corrs[p].right;
+		}
+	}
+
+	shm->npairs = npairs;
+}
+
+// initial pairs, before RT thread runs
+static void
+_monitor_pairs_init(monitor_app_t *monitor)
+{
+	monitor->ncorrs = _monitor_pairs_find(monitor, monitor->jsinks, monitor->nsinks,
+		monitor->corrs);
+
+	_monitor_pairs_publish(monitor->shm, monitor->nsinks, monitor->corrs, monitor->ncorrs);
+}
+
+// pair sinks anew after their designations or connections have changed
+static int
+_monitor_repair(monitor_app_t *monitor)
+{
+	monitor_shm_t *shm = monitor->shm;
+	monitor_corr_t corrs [PORT_MAX/2];
+
+	if(monitor->mode != MONITOR_CORRELATION)
+		return 0;
+
+	const unsigned npairs = _monitor_pairs_find(monitor, monitor->jsinks, monitor->nsinks, corrs);
+
+	// keep UI and RT thread off the pairs while they are laid out anew
+	atomic_fetch_add_explicit(&shm->gen, 1, memory_order_acq_rel);
+
+	if(_shm_sync(&monitor->sync, &shm->closing, SYNC_FREEZE, SYNC_FROZEN, 1000) == -1)
+	{
+		atomic_store_explicit(&monitor->sync, SYNC_NONE, memory_order_release);
+		atomic_fetch_add_explicit(&shm->gen, 1, memory_order_acq_rel);
+		return -1;
+	}
+
+	memcpy(monitor->corrs, corrs, npairs*sizeof(monitor_corr_t));
+	monitor->ncorrs = npairs;
+	_monitor_pairs_publish(shm, monitor->nsinks, corrs, npairs);
+
+	atomic_store_explicit(&monitor->sync, SYNC_NONE, memory_order_release);
+	atomic_fetch_add_explicit(&shm->gen, 1, memory_order_acq_rel);
+
+	return 0;
+}
+
+static int
+_monitor_resize(monitor_app_t *monitor, monitor_app_t *next, unsigned nsinks)
+{
+	const unsigned osinks = monitor->nsinks;
+	monitor_shm_t *oshm = monitor->shm;
+
+	if(nsinks == osinks)
+		return 0;
+
+	// segment only ever grows, so that current mappings of it stay valid
+	size_t size = _monitor_shm_size(nsinks);
+	if(size < monitor->shm_size)
+		size = monitor->shm_size;
+
+	if( (size > monitor->shm_size) && (ftruncate(monitor->fd, size) == -1) )
+		return -1;
+
+	monitor_shm_t *shm = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, monitor->fd, 0);
+	if(shm == MAP_FAILED)
+		return -1;
+
+	next->client = monitor->client;
+	next->type = monitor->type;
+	next->mode = monitor->mode;
+	next->shm = shm;
+
+	if(_monitor_app_alloc(next, nsinks) == -1)
+	{
+		munmap(shm, size);
+		return -1;
+	}
+
+	// keep existing ports and register missing ones while still running
+	bool failed = false;
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		next->jsinks[i] = (i < osinks)
+			? monitor->jsinks[i]
+			: _monitor_sink_register(monitor, i);
+
+		failed = failed || !next->jsinks[i];
+	}
+
+	if(!failed && (next->mode == MONITOR_CORRELATION))
+		next->ncorrs = _monitor_pairs_find(monitor, next->jsinks, nsinks, next->corrs);
+
+	// keep UI and RT thread off the meters while they are laid out anew
+	atomic_fetch_add_explicit(&oshm->gen, 1, memory_order_acq_rel);
+
+	if(failed
+		|| (_shm_sync(&monitor->sync, &oshm->closing, SYNC_FREEZE, SYNC_FROZEN, 1000) == -1) )
+	{
+		atomic_store_explicit(&monitor->sync, SYNC_NONE, memory_order_release);
+		atomic_fetch_add_explicit(&oshm->gen, 1, memory_order_acq_rel);
+
+		for(unsigned i = osinks; i < nsinks; i++)
+			_monitor_port_unregister(monitor, next->jsinks[i]);
+
+		_monitor_app_free(next);
+		munmap(shm, size);
+		return -1;
+	}
+
+	// keep spectrum worker off shm, too
+	if(monitor->spectrum)
+		pthread_mutex_lock(&monitor->spectrum->lock);
+
+	_shm_header_init(&shm->header, size, next->type, nsinks, 0);
+
+	// history, spectrum and statistics of sinks move with size of what is before them,
+	// which may overlap them
+	const unsigned ksinks = nsinks < osinks ? nsinks : osinks;
+	if(nsinks > osinks) // move last first
+	{
+		memmove(_monitor_shm_sink(shm, nsinks, 0), _monitor_shm_sink(shm, osinks, 0),
+			ksinks*sizeof(monitor_sink_t));
+		memmove(_monitor_shm_spectrum(shm, nsinks, 0), _monitor_shm_spectrum(shm, osinks, 0),
+			ksinks*MONITOR_BANDS*sizeof(float));
+	}
+	memmove(_monitor_shm_history(shm, nsinks, 0), _monitor_shm_history(shm, osinks, 0),
+		ksinks*MONITOR_HISTORY*sizeof(monitor_history_t));
+	if(nsinks < osinks)
+	{
+		memmove(_monitor_shm_spectrum(shm, nsinks, 0), _monitor_shm_spectrum(shm, osinks, 0),
+			ksinks*MONITOR_BANDS*sizeof(float));
+		memmove(_monitor_shm_sink(shm, nsinks, 0), _monitor_shm_sink(shm, osinks, 0),
+			ksinks*sizeof(monitor_sink_t));
+	}
+
+	for(unsigned i = osinks*MONITOR_SLOTS; i < nsinks*MONITOR_SLOTS; i++)
+		atomic_store_explicit(&shm->jgains[i], 0, memory_order_relaxed);
+
+	for(unsigned i = osinks; i < nsinks; i++)
+	{
+		memset(_monitor_shm_history(shm, nsinks, i), 0x0, MONITOR_HISTORY*sizeof(monitor_history_t));
+		memset(_monitor_shm_spectrum(shm, nsinks, i), 0x0, MONITOR_BANDS*sizeof(float));
+		memset(_monitor_shm_sink(shm, nsinks, i), 0x0, sizeof(monitor_sink_t));
+	}
+
+	// pairs come after all of the above, laid out anew
+	_monitor_pairs_publish(shm, nsinks, next->corrs, next->ncorrs);
+
+	// RT thread leaves meters alone while frozen
+	_monitor_meters_copy(next, monitor);
+
+	// RT thread swaps in new state at its next cycle boundary
+	monitor->next = next;
+	if(_shm_sync(&monitor->sync, &oshm->closing, SYNC_SWAP, SYNC_NONE, 0) == -1)
+	{
+		// closing, RT thread will not run again, new ports go with the client
+		if(monitor->spectrum)
+			pthread_mutex_unlock(&monitor->spectrum->lock);
+
+		_monitor_app_free(next);
+		munmap(shm, size);
+		return -1;
+	}
+
+	if(monitor->spectrum)
+	{
+		monitor->spectrum->shm = shm;
+		monitor->spectrum->nsinks = nsinks;
+		pthread_mutex_unlock(&monitor->spectrum->lock);
+	}
+
+	atomic_fetch_add_explicit(&shm->gen, 1, memory_order_acq_rel);
+
+	// next now holds the old state, drop what is no longer monitored
+	for(unsigned i = nsinks; i < osinks; i++)
+		_monitor_port_unregister(monitor, next->jsinks[i]);
+
+	munmap(next->shm, monitor->shm_size);
+	_monitor_app_free(next);
+	monitor->shm_size = size;
+
+	return 0;
+}
+
+// single writer, no need for read-modify-write
+static inline void
+_midi_monitor_count(atomic_uint *counter, uint32_t n)
+{
+	atomic_store_explicit(counter,
+		atomic_load_explicit(counter, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// count events into statistics and keep them in ring, highest note-on velocity
+static inline float
+_midi_monitor_vel(void *psink, monitor_midi_t *midi, jack_nframes_t time)
+{
+	float vel = 0.f;
+	const uint32_t count = jack_midi_get_event_count(psink);
+	uint32_t events = atomic_load_explicit(&midi->events, memory_order_relaxed);
+	uint32_t bytes = 0;
+	uint32_t channels = 0;
+	uint32_t kinds [MONITOR_KINDS] = { 0 };
+
+	for(unsigned k = 0; k < count; k++)
+	{
+		jack_midi_event_t ev;
+		jack_midi_event_get(&ev, psink, k);
+
+		if(ev.size == 0)
+			continue;
+
+		monitor_event_t *event = &midi->ring[events % MONITOR_EVENTS];
+		const size_t size = ev.size < MONITOR_EVENT_SIZE ? ev.size : MONITOR_EVENT_SIZE;
+
+		event->time = time + ev.time;
+		event->size = ev.size;
+		for(unsigned b = 0; b < size; b++)
+			event->data[b] = ev.buffer[b];
+
+		// publish entry, UI drops entries a whole ring behind the head it reads after copying
+		atomic_store_explicit(&midi->events, ++events, memory_order_release);
+		bytes += ev.size;
+
+		const uint8_t status = ev.buffer[0];
+		if(status < 0x80) // stray data byte
+			continue;
+
+		kinds[(status >> 4) - 0x8]++;
+		channels |= (status < 0xf0)
+			? 1 << (status & 0x0f)
+			: 1 << MONITOR_SYSTEM;
+
+		if( (ev.size == 3) && ((status & 0xf0) == 0x90) )
+		{
+			if(ev.buffer[2] > vel)
+				vel = ev.buffer[2];
+		}
+	}
+
+	if(!bytes)
+		return vel;
+
+	_midi_monitor_count(&midi->bytes, bytes);
+	for(unsigned k = 0; k < MONITOR_KINDS; k++)
+	{
+		if(kinds[k])
+			_midi_monitor_count(&midi->kinds[k], kinds[k]);
+	}
+	if(channels)
+		atomic_fetch_or_explicit(&midi->channels, channels, memory_order_relaxed);
+
+	return vel;
+}
+
+static int
+_audio_monitor_process(jack_nframes_t nframes, void *arg)
+{
+	monitor_app_t *monitor = arg;
+	monitor_shm_t *shm = monitor->shm;
+
+	if(  atomic_load_explicit(&monitor_closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	_monitor_sync_handle(monitor);
+	shm = monitor->shm;
+
+	if(monitor->frozen) // main thread lays out shm and carries meters over
+		return 0;
+
+	const unsigned nsinks = monitor->nsinks;
+	const bool metered = _monitor_mode_metered(monitor->mode);
+	const unsigned pass = metered
+		? MONITOR_GROUPS*MONITOR_LANES
+		: MONITOR_LANES;
+	const float *psinks [MONITOR_GROUPS*MONITOR_LANES];
+	float levels [MONITOR_SLOTS][MONITOR_GROUPS*MONITOR_LANES] = { { 0.f } };
+	monitor_stats_t cycle [MONITOR_GROUPS];
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		const unsigned l = i % pass;
+
+		if(l == 0) // scan next sinks, last one repeated to fill up pass
+		{
+			for(unsigned g = 0; g < pass; g++)
+			{
+				jack_port_t *jsink = monitor->jsinks[i + g < nsinks ? i + g : nsinks - 1];
+				psinks[g] = jack_port_get_buffer(jsink, nframes);
+			}
+
+			// one scan per group with sinks in it feeds history and, unless metered, levels
+			for(unsigned g = 0; g*MONITOR_LANES < pass && i + g*MONITOR_LANES < nsinks; g++)
+			{
+				_audio_monitor_history(monitor, shm, i + g*MONITOR_LANES,
+					&psinks[g*MONITOR_LANES], nframes, &cycle[g]);
+
+				if(metered)
+					continue;
+
+				for(unsigned j = 0; j < MONITOR_LANES; j++)
+					levels[0][g*MONITOR_LANES + j] = _audio_monitor_stats_peak(&cycle[g], j);
+			}
+
+			if(monitor->mode == MONITOR_TRUE_PEAK)
+				_audio_monitor_true_peaks(monitor, &monitor->meters[i / MONITOR_LANES],
+					psinks, nsinks - i < pass ? nsinks - i : pass, nframes, levels);
+			else if(metered)
+				_audio_monitor_meter(monitor, &monitor->meters[i / MONITOR_LANES],
+					psinks, nframes, levels);
+		}
+
+		// UI does ballistics and dB conversion
+		atomic_int *slots = _monitor_shm_slots(shm, i);
+
+		for(unsigned s = 0; s < MONITOR_SLOTS; s++)
+			_monitor_hold(&slots[s], _monitor_peak_to_held(levels[s][l]));
+	}
+
+	if(monitor->mode == MONITOR_CORRELATION)
+		_audio_monitor_correlation(monitor, shm, nframes);
+
+	if(  (monitor->mode == MONITOR_RMS) || (monitor->mode == MONITOR_LUFS)
+		|| (monitor->mode == MONITOR_CORRELATION) )
+	{
+		_audio_monitor_meter_advance(monitor, nframes);
+	}
+
+	_audio_monitor_history_advance(monitor, shm, nframes);
+
+	if(monitor->spectrum)
+		_audio_monitor_spectrum_push(monitor, nframes);
+
+	atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+
+static int
+_midi_monitor_process(jack_nframes_t nframes, void *arg)
+{
+	monitor_app_t *monitor = arg;
+	monitor_shm_t *shm = monitor->shm;
+
+	if(  atomic_load_explicit(&monitor_closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	_monitor_sync_handle(monitor);
+	shm = monitor->shm;
+
+	if(monitor->frozen) // main thread lays out shm
+		return 0;
+
+	const unsigned nsinks = monitor->nsinks;
+	const jack_nframes_t time = jack_last_frame_time(monitor->client);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		jack_port_t *jsink = monitor->jsinks[i];
+		void *psink = jack_port_get_buffer(jsink, nframes);
+		const float vel = _midi_monitor_vel(psink, _monitor_shm_midi(shm, nsinks, i), time);
+
+		// UI does ballistics
+		_monitor_hold(_monitor_shm_slots(shm, i), (int32_t)vel);
+	}
+
+	atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+
+#ifdef JACK_HAS_METADATA_API
+// keep path of message, cut short if need be
+static inline void
+_osc_monitor_path(monitor_path_t *entry, const char *path, jack_nframes_t time)
+{
+	unsigned c;
+
+	for(c = 0; (c < MONITOR_PATH_SIZE - 1) && path[c]; c++)
+		entry->path[c] = path[c];
+	entry->path[c] = '\0';
+
+	entry->time = time;
+}
+
+// count messages of packet and its nested bundles into statistics, keep their paths in ring
+static void
+_osc_monitor_packet(monitor_osc_t *osc, const uint8_t *body, size_t size,
+	jack_nframes_t time, uint32_t *messages)
+{
+	LV2_OSC_Reader reader;
+	lv2_osc_reader_initialize(&reader, body, size);
+
+	if(lv2_osc_reader_is_bundle(&reader))
+	{
+		_midi_monitor_count(&osc->bundles, 1);
+
+		OSC_READER_BUNDLE_FOREACH(&reader, itm, size)
+		{
+			_osc_monitor_packet(osc, itm->body, itm->size, time, messages);
+		}
+	}
+	else if(lv2_osc_reader_is_message(&reader))
+	{
+		const char *path;
+
+		if(!lv2_osc_reader_get_string(&reader, &path))
+		{
+			_midi_monitor_count(&osc->errors, 1);
+			return;
+		}
+
+		_osc_monitor_path(&osc->ring[*messages % MONITOR_PATHS], path, time);
+
+		atomic_store_explicit(&osc->messages, ++(*messages), memory_order_release);
+	}
+	else
+	{
+		_midi_monitor_count(&osc->errors, 1);
+	}
+}
+
+static int
+_osc_monitor_process(jack_nframes_t nframes, void *arg)
+{
+	monitor_app_t *monitor = arg;
+	monitor_shm_t *shm = monitor->shm;
+
+	if(  atomic_load_explicit(&monitor_closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	_monitor_sync_handle(monitor);
+	shm = monitor->shm;
+
+	if(monitor->frozen) // main thread lays out shm
+		return 0;
+
+	const unsigned nsinks = monitor->nsinks;
+	const jack_nframes_t time = jack_last_frame_time(monitor->client);
+
+	for(unsigned i = 0; i < nsinks; i++)
+	{
+		jack_port_t *jsink = monitor->jsinks[i];
+		void *psink = jack_port_get_buffer(jsink, nframes);
+		monitor_osc_t *osc = _monitor_shm_osc(shm, nsinks, i);
+		const uint32_t count = jack_midi_get_event_count(psink);
+		uint32_t messages = atomic_load_explicit(&osc->messages, memory_order_relaxed);
+		const uint32_t first = messages;
+		uint32_t bytes = 0;
+
+		for(unsigned k = 0; k < count; k++)
+		{
+			jack_midi_event_t ev;
+			jack_midi_event_get(&ev, psink, k);
+
+			if(ev.size == 0)
+				continue;
+
+			_osc_monitor_packet(osc, ev.buffer, ev.size, time + ev.time, &messages);
+			bytes += ev.size;
+		}
+
+		if(bytes)
+			_midi_monitor_count(&osc->bytes, bytes);
+
+		// UI does ballistics
+		_monitor_hold(_monitor_shm_slots(shm, i), (int32_t)(messages - first));
+	}
+
+	atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+
+// extremes and sum of span of a CV sink, first span of a block starts it anew
+static inline void
+_cv_monitor_scan(const float *psink, jack_nframes_t nframes, monitor_block_t *acc,
+	bool first)
+{
+	float min = first ? psink[0] : acc->min;
+	float max = first ? psink[0] : acc->max;
+	float sum = first ? 0.f : acc->mean;
+
+	for(jack_nframes_t k = 0; k < nframes; k++)
+	{
+		const float x = psink[k];
+
+		min = x < min ? x : min;
+		max = x > max ? x : max;
+		sum += x;
+	}
+
+	acc->min = min;
+	acc->max = max;
+	acc->mean = sum;
+}
+
+// split CV sink at blocks, publish each whole one
+static void
+_cv_monitor_blocks(monitor_app_t *monitor, monitor_shm_t *shm, unsigned i,
+	const float *psink, jack_nframes_t nframes)
+{
+	monitor_block_t *acc = &monitor->blocks[i];
+	monitor_cv_t *cv = _monitor_shm_cv(shm, monitor->nsinks, i);
+	jack_nframes_t fill = monitor->fill;
+
+	for(jack_nframes_t offset = 0; offset < nframes; )
+	{
+		jack_nframes_t n = monitor->block - fill;
+		if(n > nframes - offset)
+			n = nframes - offset;
+
+		_cv_monitor_scan(&psink[offset], n, acc, fill == 0);
+
+		offset += n;
+		fill += n;
+
+		if(fill == monitor->block)
+		{
+			const uint32_t blocks = atomic_load_explicit(&cv->blocks, memory_order_relaxed);
+			monitor_block_t *entry = &cv->ring[blocks % MONITOR_CV_BLOCKS];
+
+			entry->min = acc->min;
+			entry->max = acc->max;
+			entry->mean = acc->mean / monitor->block;
+
+			atomic_store_explicit(&cv->blocks, blocks + 1, memory_order_release);
+			fill = 0;
+		}
+	}
+}
+
+static int
+_cv_monitor_process(jack_nframes_t nframes, void *arg)
+{
+	monitor_app_t *monitor = arg;
+	monitor_shm_t *shm = monitor->shm;
+
+	if(  atomic_load_explicit(&monitor_closed, memory_order_relaxed)
+		|| atomic_load_explicit(&shm->closing, memory_order_relaxed) )
+	{
+		return 0;
+	}
+
+	_monitor_sync_handle(monitor);
+	shm = monitor->shm;
+
+	if(monitor->frozen) // main thread lays out shm and carries blocks over
+		return 0;
+
+	const unsigned nsinks = monitor->nsinks;
+	const float *psinks [MONITOR_LANES];
+	monitor_stats_t cycle;
+
+	for(unsigned i = 0; i < nsinks; i += MONITOR_LANES)
+	{
+		// scan next sinks, last one repeated to fill up lanes
+		for(unsigned l = 0; l < MONITOR_LANES; l++)
+		{
+			jack_port_t *jsink = monitor->jsinks[i + l < nsinks ? i + l : nsinks - 1];
+			psinks[l] = jack_port_get_buffer(jsink, nframes);
+		}
+
+		_audio_monitor_history(monitor, shm, i, psinks, nframes, &cycle);
+
+		for(unsigned l = 0; (l < MONITOR_LANES) && (i + l < nsinks); l++)
+			_cv_monitor_blocks(monitor, shm, i + l, psinks[l], nframes);
+	}
+
+	_audio_monitor_meter_advance(monitor, nframes);
+	_audio_monitor_history_advance(monitor, shm, nframes);
+
+	atomic_fetch_add_explicit(&shm->seq, 1, memory_order_release);
+
+	return 0;
+}
+#endif
+
+static inline JackProcessCallback
+_monitor_process_callback(port_type_t type)
+{
+	switch(type)
+	{
+		case TYPE_AUDIO:
+			return _audio_monitor_process;
+#ifdef JACK_HAS_METADATA_API
+		case TYPE_OSC:
+			return _osc_monitor_process;
+		case TYPE_CV:
+			return _cv_monitor_process;
+#endif
+		case TYPE_MIDI:
+		default:
+			return _midi_monitor_process;
+	}
+}
+
+static int
+_monitor_ports_register(monitor_app_t *monitor)
+{
+	bool failed = false;
+
+	for(unsigned i = 0; i < monitor->nsinks; i++)
+	{
+		monitor->jsinks[i] = _monitor_sink_register(monitor, i);
+		failed = failed || !monitor->jsinks[i];
+	}
+
+	return failed ? -1 : 0;
+}
+
+static void
+_monitor_ports_unregister(monitor_app_t *monitor)
+{
+	for(unsigned i = 0; i < monitor->nsinks; i++)
+	{
+		_monitor_port_unregister(monitor, monitor->jsinks[i]);
+	}
+}
+
+static int
+_monitor_shm_open(monitor_app_t *monitor, int oflag)
+{
+	const unsigned nsinks = monitor->nsinks;
+
+	monitor->shm_size = _monitor_shm_size(nsinks);
+	monitor->fd = shm_open(monitor->name, O_RDWR | O_CREAT | oflag, S_IRUSR | S_IWUSR);
+	if(monitor->fd == -1)
+		return -1;
+
+	if(  (ftruncate(monitor->fd, monitor->shm_size) == -1)
+		|| ((monitor->shm = mmap(NULL, monitor->shm_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, monitor->fd, 0)) == MAP_FAILED) )
+	{
+		monitor->shm = NULL;
+		close(monitor->fd);
+		shm_unlink(monitor->name);
+		return -1;
+	}
+
+	_shm_header_init(&monitor->shm->header, monitor->shm_size, monitor->type, nsinks, 0);
+
+	atomic_init(&monitor->shm->closing, false);
+	atomic_init(&monitor->shm->gen, 0);
+	atomic_init(&monitor->shm->resize, 0);
+	atomic_init(&monitor->shm->repair, false);
+	atomic_init(&monitor->sync, SYNC_NONE);
+
+	atomic_init(&monitor->shm->seq, 0);
+	atomic_init(&monitor->shm->history, 0);
+	monitor->shm->mode = monitor->mode;
+
+	for(unsigned i = 0; i < nsinks*MONITOR_SLOTS; i++)
+		atomic_init(&monitor->shm->jgains[i], 0);
+
+	memset(_monitor_shm_history(monitor->shm, nsinks, 0), 0x0,
+		nsinks*MONITOR_HISTORY*sizeof(monitor_history_t));
+	memset(_monitor_shm_sink(monitor->shm, nsinks, 0), 0x0,
+		nsinks*sizeof(monitor_sink_t));
+	_monitor_pairs_publish(monitor->shm, nsinks, monitor->corrs, monitor->ncorrs);
+
+	if(sem_init(&monitor->shm->done, 1, 0) == -1)
+	{
+		munmap(monitor->shm, monitor->shm_size);
+		monitor->shm = NULL;
+		close(monitor->fd);
+		shm_unlink(monitor->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+_monitor_shm_close(monitor_app_t *monitor)
+{
+	sem_destroy(&monitor->shm->done);
+	munmap(monitor->shm, monitor->shm_size);
+	monitor->shm = NULL;
+
+	close(monitor->fd);
+	shm_unlink(monitor->name);
+}
+
+static void
+_monitor_run(monitor_app_t *monitor, monitor_app_t *next)
+{
+	while(true)
+	{
+		sem_wait(&monitor->shm->done);
+
+		if(atomic_load_explicit(&monitor->shm->closing, memory_order_relaxed))
+			break;
+
+		const uint32_t resize = atomic_exchange_explicit(&monitor->shm->resize, 0,
+			memory_order_acquire);
+		const bool repair = atomic_exchange_explicit(&monitor->shm->repair, false,
+			memory_order_acquire);
+
+		if(resize && (_monitor_resize(monitor, next, resize >> 16) == -1))
+		{
+			fprintf(stderr, "failed to resize monitor\n");
+		}
+		else if(repair && (_monitor_repair(monitor) == -1))
+		{
+			fprintf(stderr, "failed to pair monitor sinks\n");
+		}
+	}
+
+	atomic_store_explicit(&monitor->shm->closing, true, memory_order_relaxed);
+}
+
+#endif // _PATCHMATRIX_MONITOR_H
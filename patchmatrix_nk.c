@@ -18,6 +18,7 @@
 #include <limits.h>
 #include <dirent.h>
 #include <libgen.h>
+#include <time.h>
 
 #include <patchmatrix_jack.h>
 #include <patchmatrix_db.h>
@@ -265,6 +266,80 @@ _client_connectors(struct nk_context *ctx, app_t *app, client_t *client,
 	}
 }
 
+// take held peaks of sinks, then sources, let them fall like monitor meters
+static bool
+_mixer_peaks_update(client_t *client, mixer_shm_t *shm, unsigned nlevels)
+{
+	const float silence = -64.f;
+	const float range = 70.f;
+
+	if(nlevels != client->nlevels)
+	{
+		float *levels = realloc(client->levels, nlevels*sizeof(float));
+		if(!levels)
+			return false;
+
+		for(unsigned k = client->nlevels; k < nlevels; k++)
+			levels[k] = silence;
+
+		client->levels = levels;
+		client->nlevels = nlevels;
+	}
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const double stamp = ts.tv_sec + ts.tv_nsec*1e-9;
+	const float dt = client->stamp ? stamp - client->stamp : 0.f;
+	client->stamp = stamp;
+
+	for(unsigned k = 0; k < nlevels; k++)
+	{
+		const int32_t held = atomic_exchange_explicit(&_mixer_shm_peaks(shm)[k], 0,
+			memory_order_relaxed);
+		const float peak = (held > 0)
+			? 20.f*log10f(_monitor_held_to_peak(held)) // dBFS
+			: silence;
+		float level = client->levels[k] - dt * 2.f * range;
+
+		if(peak > level)
+			level = peak;
+
+		client->levels[k] = (level < silence) ? silence : level;
+	}
+
+	return true;
+}
+
+// thin bar of peak level, cyan to yellow up to -6 dBFS, then to red
+static void
+_mixer_peak_draw(struct nk_command_buffer *canvas, struct nk_rect bar, float dBFS,
+	bool vertical, uint8_t alph)
+{
+	const float mx1 = 58.f / 70.f;
+	const float e = NK_CLAMP(0.f, (dBFS + 64.f) / 70.f, 1.f);
+	const uint8_t dcol = (e > mx1)
+		? 0xff * (e - mx1) / (1.f - mx1)
+		: 0xff * e / mx1;
+	const struct nk_color col = (e > mx1)
+		? nk_rgba(0xff, 0xff - dcol, 0x00, alph)
+		: nk_rgba(dcol, 0xff, 0xff - dcol, alph);
+
+	if(e <= 0.f)
+		return;
+
+	if(vertical) // grows upwards
+	{
+		bar.y += bar.h * (1.f - e);
+		bar.h *= e;
+	}
+	else // grows rightwards
+	{
+		bar.w *= e;
+	}
+
+	nk_fill_rect(canvas, bar, 0.f, col);
+}
+
 static void
 node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 {
@@ -280,9 +355,32 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 	if(atomic_load_explicit(&shm->closing, memory_order_acquire))
 		return;
 
+	if(atomic_load_explicit(&shm->gen, memory_order_acquire) & 1) // resizing
+	{
+		app->animating = true;
+		return;
+	}
+
+	if(shm->header.size != client->shm_size) // segment has grown, map it anew
+	{
+		_mixer_free(shm, client->shm_size);
+		shm = client->mixer_shm = _mixer_add(client->name, &client->shm_size);
+		if(!shm)
+			return;
+	}
+
 	const float ps = 32.f * app->scale;
-	const unsigned nx = shm->nsinks;
-	const unsigned ny = shm->nsources;
+	const unsigned nx = shm->header.nsinks;
+	const unsigned ny = shm->header.nsources;
+#ifdef JACK_HAS_METADATA_API
+	const bool is_cv = shm->header.type == TYPE_CV;
+#else
+	const bool is_cv = false;
+#endif
+	const int32_t range = is_cv ? MIXER_CV_UNITY : 3600;
+	const int32_t off = is_cv ? 0 : -3600;
+	const bool is_metered = shm->metered
+		&& _mixer_peaks_update(client, shm, nx + ny);
 
 	client->dim.x = nx * ps;
 	client->dim.y = ny * ps;
@@ -294,6 +392,7 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 
 	if(_client_moveable(ctx, app, client, &bounds))
 	{
+		atomic_store_explicit(&shm->closing, true, memory_order_release);
 		sem_post(&shm->done);
 	}
 
@@ -301,6 +400,21 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 		&& !nodedit->linking.active;
 	const bool is_hilighted = client->hilighted || client->hovered || client->moving;
 
+	if(  editable && client->hovered
+		&& nk_input_is_key_down(in, NK_KEY_CTRL)
+		&& (in->mouse.scroll_delta.y != 0.f) ) // resize sinks, or sources with shift
+	{
+		const int dd = (in->mouse.scroll_delta.y > 0.f) ? 1 : -1;
+		const bool has_shift = nk_input_is_key_down(in, NK_KEY_SHIFT);
+		const int nsinks = nx + (has_shift ? 0 : dd);
+		const int nsources = ny + (has_shift ? dd : 0);
+
+		in->mouse.scroll_delta.y = 0.f;
+
+		if( (nsinks > 0) && (nsources > 0) )
+			_shm_resize_request(&shm->resize, &shm->done, nsinks, nsources);
+	}
+
 	nk_layout_space_push(ctx, nk_layout_space_rect_to_local(ctx, bounds));
 
 	struct nk_rect body;
@@ -348,7 +462,7 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 			float y = body.y + ps/2;
 			for(unsigned j = 0; j < ny; j++)
 			{
-				int32_t mBFS = atomic_load_explicit(&shm->jgains[j][i], memory_order_acquire);
+				int32_t mBFS = atomic_load_explicit(_mixer_shm_gain(shm, j, i), memory_order_acquire);
 
 				const struct nk_rect tile = nk_rect(x - ps/2, y - ps/2, ps, ps);
 
@@ -388,11 +502,13 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 #endif
 						{
 							const bool has_shift = nk_input_is_key_down(in, NK_KEY_SHIFT);
-							const float mul = has_shift ? 10.f : 100.f;
-							mBFS = NK_CLAMP(-3600, mBFS + dd*mul, 3600);
+							const float mul = is_cv
+								? (has_shift ? 1.f : 10.f)
+								: (has_shift ? 10.f : 100.f);
+							mBFS = NK_CLAMP(-range, mBFS + dd*mul, range);
 						}
 
-						atomic_store_explicit(&shm->jgains[j][i], mBFS, memory_order_release);
+						atomic_store_explicit(_mixer_shm_gain(shm, j, i), mBFS, memory_order_release);
 					}
 				}
 
@@ -421,7 +537,9 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 					}
 
 					{
-						const size_t tmp_len = snprintf(tmp, 32, "%+2.2f dBFS", dBFS);
+						const size_t tmp_len = is_cv
+							? snprintf(tmp, 32, "%+1.3f", (float)mBFS / MIXER_CV_UNITY)
+							: snprintf(tmp, 32, "%+2.2f dBFS", dBFS);
 						const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
 						const float fy = body.y + body.h + fh + fh/2;
 						const struct nk_rect body2 = {
@@ -433,11 +551,27 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 						nk_draw_text(canvas, body2, tmp, tmp_len, font,
 							style->normal.data.color, style->text_normal);
 					}
+
+					if(is_metered) // peaks of sink and source of cell
+					{
+						const size_t tmp_len = snprintf(tmp, 32, "%+.1f / %+.1f dBFS",
+							client->levels[i], client->levels[nx + j]);
+						const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+						const float fy = body.y + body.h + 2*fh + fh/2;
+						const struct nk_rect body2 = {
+							.x = body.x + (body.w - fw)/2,
+							.y = fy,
+							.w = fw,
+							.h = fh
+						};
+						nk_draw_text(canvas, body2, tmp, tmp_len, font,
+							style->normal.data.color, style->text_normal);
+					}
 				}
 
-				if(mBFS > -3600)
+				if(is_cv ? (mBFS != off) : (mBFS > off))
 				{
-					const float alpha = (dBFS + 36.f) / 72.f;
+					const float alpha = (float)(mBFS + range) / (2*range);
 					const float beta = NK_PI/2;
 
 					nk_stroke_arc(canvas,
@@ -458,13 +592,686 @@ node_editor_mixer(struct nk_context *ctx, app_t *app, client_t *client)
 			x += ps;
 		}
 
+		// peaks of sinks along top edge, of sources along right edge, clear of knobs
+		if(is_metered)
+		{
+			const float pm = ps/20;
+			const float pw = ps/10;
+			const uint8_t alph = editable ? 0xbf : 0x3f;
+
+			for(unsigned i = 0; i < nx; i++)
+			{
+				const struct nk_rect bar = nk_rect(body.x + i*ps + pm, body.y + pm,
+					ps - 2*pm, pw);
+
+				_mixer_peak_draw(canvas, bar, client->levels[i], false, alph);
+			}
+
+			for(unsigned j = 0; j < ny; j++)
+			{
+				const struct nk_rect bar = nk_rect(body.x + body.w - pm - pw, body.y + j*ps + pm,
+					pw, ps - 2*pm);
+
+				_mixer_peak_draw(canvas, bar, client->levels[nx + j], true, alph);
+			}
+		}
+
 		nk_stroke_rect(canvas, body, style->rounding, style->border, hilight_col);
+
+		// scene slots along left edge
+		const float ss = ps/2;
+		const uint32_t stored = atomic_load_explicit(&shm->stored, memory_order_acquire);
+		const uint32_t current = atomic_load_explicit(&shm->current, memory_order_acquire);
+
+		for(unsigned s = 0; s < MIXER_SCENE_MAX; s++)
+		{
+			const struct nk_rect slot = nk_rect(body.x - ss - ss/2, body.y + s*ss, ss, ss);
+			const bool is_stored = stored & (1 << s);
+			const bool mouse_hovering_over_slot = nk_input_is_mouse_hovering_rect(in, slot);
+
+			if(editable && mouse_hovering_over_slot && !client->moving)
+			{
+				if(nk_input_mouse_clicked(in, NK_BUTTON_LEFT, slot)) // recall, or store with ctrl
+				{
+					const bool has_ctrl = nk_input_is_key_down(in, NK_KEY_CTRL);
+
+					if(has_ctrl || is_stored)
+						_mixer_scene_request(shm, s, has_ctrl, app->scene_fade);
+				}
+				else if(in->mouse.scroll_delta.y != 0.f) // change crossfade length
+				{
+					const bool has_shift = nk_input_is_key_down(in, NK_KEY_SHIFT);
+					const int fade = app->scene_fade
+						+ in->mouse.scroll_delta.y * (has_shift ? 10 : 100);
+
+					app->scene_fade = NK_CLAMP(0, fade, MIXER_FADE_MAX);
+					in->mouse.scroll_delta.y = 0.f;
+				}
+			}
+
+			if(is_stored)
+				nk_fill_rect(canvas, slot, style->rounding, toggle_col);
+
+			nk_stroke_rect(canvas, slot, style->rounding, style->border,
+				current == s + 1 ? hilight_color : stroke_col);
+
+			if(mouse_hovering_over_slot && !client->moving)
+			{
+				char tmp [32];
+
+				const struct nk_user_font *font = ctx->style.font;
+
+				const float fh = font->height;
+
+				{
+					const size_t tmp_len = snprintf(tmp, 32, "[scene %u]", s+1);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const float fy = body.y + body.h + fh/2;
+					const struct nk_rect body2 = {
+						.x = body.x + (body.w - fw)/2,
+						.y = fy,
+						.w = fw,
+						.h = fh
+					};
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+
+				{
+					const size_t tmp_len = snprintf(tmp, 32, "%u ms", app->scene_fade);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const float fy = body.y + body.h + fh + fh/2;
+					const struct nk_rect body2 = {
+						.x = body.x + (body.w - fw)/2,
+						.y = fy,
+						.w = fw,
+						.h = fh
+					};
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+			}
+		}
 	}
 
 	_client_connectors(ctx, app, client, nk_vec2(bounds.w, bounds.h), is_hilighted);
 	app->animating = true;
 }
 
+// dBFS of held sample peak or mean square, LUFS if K-weighted
+static inline float
+_monitor_level_from_held(monitor_mode_t mode, unsigned slot, int32_t held)
+{
+	const float level = _monitor_held_to_peak(held);
+
+	switch(mode)
+	{
+		case MONITOR_RMS:
+			if(slot == 0)
+				return 10.f*log10f(level);
+			// fall-through
+		case MONITOR_PEAK:
+		case MONITOR_TRUE_PEAK:
+		case MONITOR_SPECTRUM:
+		case MONITOR_CORRELATION:
+			return 6.f + 20.f*log10f(level / 2.f); // dBFS+6
+		case MONITOR_LUFS:
+		default:
+			return -0.691f + 10.f*log10f(level);
+	}
+}
+
+// take consistent copy of spectrum published by worker, let bands fall like meters
+static bool
+_monitor_bands_update(client_t *client, monitor_shm_t *shm, unsigned ny, float dt)
+{
+	const float silence = -64.f;
+	const float range = 70.f;
+	const unsigned nbands = ny*MONITOR_BANDS;
+
+	if(nbands != client->nbands)
+	{
+		float *bands = realloc(client->bands, 2*(nbands ? nbands : 1)*sizeof(float));
+		if(!bands)
+			return false;
+
+		for(unsigned b = 0; b < nbands; b++)
+			bands[b] = silence;
+
+		client->bands = bands;
+		client->nbands = nbands;
+	}
+
+	float *copy = &client->bands[nbands];
+	const uint32_t seq = atomic_load_explicit(&shm->spectrum, memory_order_acquire);
+	bool fresh = false;
+
+	// worker may be publishing meanwhile, then keep last copy
+	if( !(seq & 1) && (seq != client->spectrum) )
+	{
+		memcpy(copy, _monitor_shm_spectrum(shm, ny, 0), nbands*sizeof(float));
+		atomic_thread_fence(memory_order_acquire);
+
+		fresh = (atomic_load_explicit(&shm->spectrum, memory_order_relaxed) == seq);
+		if(fresh)
+			client->spectrum = seq;
+	}
+
+	for(unsigned b = 0; b < nbands; b++)
+	{
+		float level = client->bands[b] - dt * 2.f * range;
+
+		if(fresh && (copy[b] > 0.f))
+		{
+			const float peak = 20.f*log10f(copy[b]);
+
+			if(peak > level)
+				level = peak;
+		}
+
+		client->bands[b] = (level < silence) ? silence : level;
+	}
+
+	return true;
+}
+
+// take channels or OSC messages active since last frame, rates of events and bytes every 1/2 s
+static bool
+_monitor_rates_update(client_t *client, monitor_shm_t *shm, unsigned ny, float dt)
+{
+#ifdef JACK_HAS_METADATA_API
+	const bool is_osc = (shm->header.type == TYPE_OSC);
+#else
+	const bool is_osc = false;
+#endif
+
+	if(ny != client->nrates)
+	{
+		monitor_rate_t *rates = realloc(client->rates, (ny ? ny : 1)*sizeof(monitor_rate_t));
+		if(!rates)
+			return false;
+
+		// counters of new sinks start from zero
+		for(unsigned j = client->nrates; j < ny; j++)
+			memset(&rates[j], 0x0, sizeof(monitor_rate_t));
+
+		client->rates = rates;
+		client->nrates = ny;
+	}
+
+	const double stamp = client->stamp;
+	const double elapsed = stamp - client->rated;
+	const bool rate = (elapsed >= 0.5);
+
+	for(unsigned j = 0; j < ny; j++)
+	{
+		monitor_sink_t *sink = _monitor_shm_sink(shm, ny, j);
+		monitor_rate_t *r = &client->rates[j];
+		const uint32_t channels = is_osc
+			? (client->levels[j*MONITOR_SLOTS] > 0.f) // messages held in this frame
+			: atomic_exchange_explicit(&sink->midi.channels, 0, memory_order_relaxed);
+
+		for(unsigned c = 0; c <= MONITOR_SYSTEM; c++)
+		{
+			r->channels[c] = (channels & (1 << c))
+				? 1.f
+				: NK_MAX(r->channels[c] - dt * 2.f, 0.f);
+		}
+
+		if(!rate)
+			continue;
+
+		const uint32_t events = atomic_load_explicit(
+			is_osc ? &sink->osc.messages : &sink->midi.events, memory_order_relaxed);
+		const uint32_t bytes = atomic_load_explicit(
+			is_osc ? &sink->osc.bytes : &sink->midi.bytes, memory_order_relaxed);
+
+		if(client->rated) // counters wrap around, differences do not
+		{
+			r->event_rate = (uint32_t)(events - r->events) / elapsed;
+			r->byte_rate = (uint32_t)(bytes - r->bytes) / elapsed;
+		}
+
+		r->events = events;
+		r->bytes = bytes;
+	}
+
+	if(rate)
+		client->rated = stamp;
+
+	return true;
+}
+
+// take levels held by RT thread and let meters fall to zero in 1/2 s
+static bool
+_monitor_levels_update(client_t *client, monitor_shm_t *shm, unsigned ny)
+{
+	const port_type_t type = shm->header.type;
+	const bool is_audio = (type == TYPE_AUDIO);
+#ifdef JACK_HAS_METADATA_API
+	const bool is_osc = (type == TYPE_OSC);
+#else
+	const bool is_osc = false;
+#endif
+	const float silence = is_audio ? -64.f : 0.f;
+	const float range = is_audio ? 70.f : 127.f;
+	const unsigned nlevels = ny*MONITOR_SLOTS;
+
+	if(nlevels != client->nlevels)
+	{
+		float *levels = realloc(client->levels, (nlevels ? nlevels : 1)*sizeof(float));
+		if(!levels)
+			return false;
+
+		for(unsigned j = client->nlevels; j < nlevels; j++)
+			levels[j] = silence;
+
+		client->levels = levels;
+		client->nlevels = nlevels;
+	}
+
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const double stamp = ts.tv_sec + ts.tv_nsec*1e-9;
+	const float dt = client->stamp ? stamp - client->stamp : 0.f;
+	client->stamp = stamp;
+
+	// RT thread has run since, there may be new peaks to take
+	const uint32_t seq = atomic_load_explicit(&shm->seq, memory_order_acquire);
+	const bool fresh = (seq != client->seq);
+	client->seq = seq;
+
+	for(unsigned j = 0; j < nlevels; j++)
+	{
+		float level = client->levels[j] - dt * 2.f * range;
+
+		if(fresh)
+		{
+			const int32_t held = atomic_exchange_explicit(&shm->jgains[j], 0,
+				memory_order_relaxed);
+			const float peak = !is_audio
+				? held
+				: (held > 0)
+					? _monitor_level_from_held(shm->mode, j % MONITOR_SLOTS, held)
+					: silence;
+
+			if(peak > level)
+				level = peak;
+		}
+
+		client->levels[j] = (level < silence) ? silence : level;
+	}
+
+	if( (type == TYPE_MIDI) || is_osc )
+		return _monitor_rates_update(client, shm, ny, dt);
+
+	if(shm->mode == MONITOR_SPECTRUM)
+		return _monitor_bands_update(client, shm, ny, dt);
+
+	return true;
+}
+
+// scroll last entries of history of a sink from right to left, amplitude over scale upwards
+static void
+_monitor_history_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	monitor_shm_t *shm, unsigned ny, unsigned j, uint32_t head, float scale,
+	struct nk_rect strip)
+{
+	// RT thread is way off the older half of the ring, which is left alone
+	const unsigned nentries = MONITOR_HISTORY / 2;
+	const unsigned n = head < nentries ? head : nentries;
+	const monitor_history_t *history = _monitor_shm_history(shm, ny, j);
+	const float dx = strip.w / nentries;
+	const float mid = strip.y + strip.h/2;
+	const float amp = strip.h/2;
+	const struct nk_color range = nk_rgba(0x00, 0xff, 0xff, 0x7f);
+	const struct nk_color rms = nk_rgba(0x00, 0xff, 0xff, 0xff);
+
+	nk_stroke_line(canvas, strip.x, mid, strip.x + strip.w, mid,
+		ctx->style.window.group_border, ctx->style.window.group_border_color);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		const monitor_history_t *entry = &history[(head - 1 - i) % MONITOR_HISTORY];
+		const float x = strip.x + strip.w - (i + 1)*dx;
+		const float max = NK_CLAMP(-1.f, entry->max / scale, 1.f);
+		const float min = NK_CLAMP(-1.f, entry->min / scale, 1.f);
+		const float r = NK_MIN(entry->rms / scale, 1.f);
+
+		nk_fill_rect(canvas, nk_rect(x, mid - max*amp, dx, (max - min)*amp), 0.f, range);
+		nk_fill_rect(canvas, nk_rect(x, mid - r*amp, dx, 2.f*r*amp), 0.f, rms);
+	}
+
+	nk_stroke_rect(canvas, strip, 0.f, ctx->style.window.group_border,
+		ctx->style.window.group_border_color);
+}
+
+// bars of bands of a sink from 20 Hz on the left, dBFS upwards
+static void
+_monitor_spectrum_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	const float *bands, struct nk_rect strip)
+{
+	const float dx = strip.w / MONITOR_BANDS;
+	const uint8_t alph = 0x7f;
+
+	for(unsigned b = 0; b < MONITOR_BANDS; b++)
+	{
+		const float e = NK_CLAMP(0.f, (bands[b] + 64.f) / 64.f, 1.f);
+		const uint8_t dcol = 0xff * e;
+		const struct nk_color top = nk_rgba(dcol, 0xff, 0xff-dcol, alph);
+		const struct nk_color bottom = nk_rgba(0x00, 0xff, 0xff, alph);
+		const struct nk_rect bar = nk_rect(strip.x + b*dx, strip.y + strip.h*(1.f - e),
+			dx, strip.h*e);
+
+		nk_fill_rect_multi_color(canvas, bar, top, top, bottom, bottom);
+	}
+
+	nk_stroke_rect(canvas, strip, 0.f, ctx->style.window.group_border,
+		ctx->style.window.group_border_color);
+}
+
+// goniometer of a pair of sinks with mid upwards, correlation and balance below
+static void
+_monitor_pair_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	const monitor_pair_t *pair, struct nk_rect box)
+{
+	const struct nk_user_font *font = ctx->style.font;
+	const float line = ctx->style.window.group_border;
+	const struct nk_color border = ctx->style.window.group_border_color;
+	const struct nk_color dot = nk_rgba(0x00, 0xff, 0xff, 0xbf);
+	const float bh = box.h / 8;
+	const struct nk_rect scope = nk_rect(box.x, box.y, box.w, box.h - bh);
+	const struct nk_rect bar = nk_rect(box.x, box.y + scope.h, box.w, bh);
+	const float cx = scope.x + scope.w/2;
+	const float cy = scope.y + scope.h/2;
+	const float amp = NK_MIN(scope.w, scope.h)/2;
+
+	// axes of left and right sink
+	nk_stroke_line(canvas, cx - amp, cy - amp, cx + amp, cy + amp, line, border);
+	nk_stroke_line(canvas, cx - amp, cy + amp, cx + amp, cy - amp, line, border);
+
+	for(unsigned i = 0; i < MONITOR_POINTS; i++)
+	{
+		const float l = pair->points[i][0];
+		const float r = pair->points[i][1];
+		const float x = NK_CLAMP(-1.f, (r - l) / 2.f, 1.f);
+		const float y = NK_CLAMP(-1.f, (l + r) / 2.f, 1.f);
+
+		nk_fill_rect(canvas, nk_rect(cx + x*amp - line, cy - y*amp - line, 2*line, 2*line),
+			0.f, dot);
+	}
+
+	{
+		char tmp [32];
+		const size_t tmp_len = snprintf(tmp, 32, "%u/%u", pair->left + 1, pair->right + 1);
+		const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+
+		nk_draw_text(canvas, nk_rect(scope.x + 2*line, scope.y + line, fw, font->height),
+			tmp, tmp_len, font, nk_rgba(0x00, 0x00, 0x00, 0x00), border);
+	}
+
+	// correlation from center, red if out of phase
+	{
+		const float c = NK_CLAMP(-1.f, pair->correlation, 1.f);
+		const float w = bar.w/2 * c;
+		const struct nk_color color = (c < 0.f)
+			? nk_rgba(0xff, 0x00, 0x00, 0xbf)
+			: nk_rgba(0x00, 0xff, 0xff, 0xbf);
+
+		nk_fill_rect(canvas, nk_rect(w < 0.f ? cx + w : cx, bar.y, NK_ABS(w), bar.h), 0.f, color);
+	}
+
+	// balance as marker
+	{
+		const float b = NK_CLAMP(-1.f, pair->balance, 1.f);
+		const float x0 = cx + bar.w/2 * b;
+
+		nk_stroke_line(canvas, x0, bar.y, x0, bar.y + bar.h, 2.f * line, hilight_color);
+	}
+
+	nk_stroke_rect(canvas, scope, 0.f, line, border);
+	nk_stroke_rect(canvas, bar, 0.f, line, border);
+}
+
+static const char *monitor_kind_labels [MONITOR_KINDS] = {
+	"note-off",
+	"note-on",
+	"key-pressure",
+	"control",
+	"program",
+	"channel-pressure",
+	"pitch-bend",
+	"system"
+};
+
+// activity of channels 1 to 16 from left, system messages last
+static void
+_monitor_channels_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	const monitor_rate_t *rate, struct nk_rect strip)
+{
+	const float dx = strip.w / (MONITOR_SYSTEM + 1);
+
+	for(unsigned c = 0; c <= MONITOR_SYSTEM; c++)
+	{
+		const uint8_t alph = 0x1f + 0xc0 * rate->channels[c];
+		const struct nk_color color = (c == MONITOR_SYSTEM)
+			? nk_rgba(hilight_color.r, hilight_color.g, hilight_color.b, alph)
+			: nk_rgba(0x00, 0xff, 0xff, alph);
+		const struct nk_rect cell = nk_rect(strip.x + c*dx, strip.y, dx, strip.h);
+
+		nk_fill_rect(canvas, cell, 0.f, color);
+		nk_stroke_rect(canvas, cell, 0.f, ctx->style.window.group_border,
+			ctx->style.window.group_border_color);
+	}
+}
+
+// lines of statistics of a sink below the node
+static void
+_monitor_lines_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	char lines [][80], unsigned nlines, struct nk_rect body)
+{
+	const struct nk_user_font *font = ctx->style.font;
+	const struct nk_style_button *style = &ctx->style.button;
+	const float fh = font->height;
+
+	for(unsigned l = 0; l < nlines; l++)
+	{
+		const size_t len = strlen(lines[l]);
+		const float fw = font->width(font->userdata, fh, lines[l], len);
+		const struct nk_rect line = nk_rect(body.x, body.y + body.h + fh/2 + l*fh, fw, fh);
+
+		nk_draw_text(canvas, line, lines[l], len, font,
+			style->normal.data.color, style->text_normal);
+	}
+}
+
+// counts and recent raw events of a sink below the node
+static void
+_monitor_events_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	monitor_shm_t *shm, unsigned ny, unsigned j, const monitor_rate_t *rate,
+	struct nk_rect body)
+{
+	monitor_midi_t *midi = _monitor_shm_midi(shm, ny, j);
+	monitor_event_t events [8];
+	char lines [2 + MONITOR_KINDS + 8][80];
+	unsigned nlines = 0;
+
+	snprintf(lines[nlines++], 80, "sink %u: %"PRIu32" events, %"PRIu32" bytes",
+		j + 1, atomic_load_explicit(&midi->events, memory_order_relaxed),
+		atomic_load_explicit(&midi->bytes, memory_order_relaxed));
+	snprintf(lines[nlines++], 80, "%.0f events/s, %.0f bytes/s",
+		rate->event_rate, rate->byte_rate);
+
+	for(unsigned k = 0; k < MONITOR_KINDS; k++)
+	{
+		const uint32_t count = atomic_load_explicit(&midi->kinds[k], memory_order_relaxed);
+
+		if(count)
+			snprintf(lines[nlines++], 80, "%s: %"PRIu32, monitor_kind_labels[k], count);
+	}
+
+	// copy newest entries, then drop those RT thread may have written over meanwhile
+	const uint32_t head = atomic_load_explicit(&midi->events, memory_order_acquire);
+	const unsigned n = head < 8 ? head : 8;
+
+	for(unsigned i = 0; i < n; i++)
+		events[i] = midi->ring[(head - 1 - i) % MONITOR_EVENTS];
+
+	atomic_thread_fence(memory_order_acquire);
+	const uint32_t tail = atomic_load_explicit(&midi->events, memory_order_relaxed);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		const monitor_event_t *event = &events[i];
+		const uint32_t size = event->size < MONITOR_EVENT_SIZE ? event->size : MONITOR_EVENT_SIZE;
+		char *line = lines[nlines];
+		int len;
+
+		if(tail - (head - 1 - i) >= MONITOR_EVENTS)
+			break;
+
+		len = snprintf(line, 80, "%10"PRIu32":", event->time);
+		for(unsigned b = 0; b < size; b++)
+			len += snprintf(&line[len], 80 - len, " %02"PRIx8, event->data[b]);
+		if(event->size > size)
+			snprintf(&line[len], 80 - len, " ... (%"PRIu32")", event->size);
+
+		nlines++;
+	}
+
+	_monitor_lines_draw(ctx, canvas, lines, nlines, body);
+}
+
+// copy newest paths of an OSC sink, without those RT thread may have written over meanwhile
+static unsigned
+_monitor_paths_get(monitor_osc_t *osc, monitor_path_t paths [MONITOR_PATHS])
+{
+	const uint32_t head = atomic_load_explicit(&osc->messages, memory_order_acquire);
+	const unsigned n = head < MONITOR_PATHS ? head : MONITOR_PATHS;
+
+	for(unsigned i = 0; i < n; i++)
+		paths[i] = osc->ring[(head - 1 - i) % MONITOR_PATHS];
+
+	atomic_thread_fence(memory_order_acquire);
+	const uint32_t tail = atomic_load_explicit(&osc->messages, memory_order_relaxed);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		if(tail - (head - 1 - i) >= MONITOR_PATHS)
+			return i;
+	}
+
+	return n;
+}
+
+// counts and recent paths of a sink below the node
+static void
+_monitor_paths_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	monitor_shm_t *shm, unsigned ny, unsigned j, const monitor_rate_t *rate,
+	struct nk_rect body)
+{
+	monitor_osc_t *osc = _monitor_shm_osc(shm, ny, j);
+	monitor_path_t paths [MONITOR_PATHS];
+	char lines [3 + MONITOR_PATHS][80];
+	unsigned nlines = 0;
+
+	snprintf(lines[nlines++], 80, "sink %u: %"PRIu32" messages, %"PRIu32" bundles, %"PRIu32" bytes",
+		j + 1, atomic_load_explicit(&osc->messages, memory_order_relaxed),
+		atomic_load_explicit(&osc->bundles, memory_order_relaxed),
+		atomic_load_explicit(&osc->bytes, memory_order_relaxed));
+	snprintf(lines[nlines++], 80, "%.0f messages/s, %.0f bytes/s",
+		rate->event_rate, rate->byte_rate);
+
+	const uint32_t errors = atomic_load_explicit(&osc->errors, memory_order_relaxed);
+	if(errors)
+		snprintf(lines[nlines++], 80, "malformed: %"PRIu32, errors);
+
+	const unsigned n = _monitor_paths_get(osc, paths);
+
+	for(unsigned i = 0; i < n; i++)
+		snprintf(lines[nlines++], 80, "%10"PRIu32": %s", paths[i].time, paths[i].path);
+
+	_monitor_lines_draw(ctx, canvas, lines, nlines, body);
+}
+
+// copy newest blocks of a CV sink, without those RT thread may have written over meanwhile
+static unsigned
+_monitor_blocks_get(monitor_cv_t *cv, monitor_block_t blocks [MONITOR_CV_BLOCKS])
+{
+	const uint32_t head = atomic_load_explicit(&cv->blocks, memory_order_acquire);
+	const unsigned n = head < MONITOR_CV_BLOCKS ? head : MONITOR_CV_BLOCKS;
+
+	for(unsigned i = 0; i < n; i++)
+		blocks[i] = cv->ring[(head - 1 - i) % MONITOR_CV_BLOCKS];
+
+	atomic_thread_fence(memory_order_acquire);
+	const uint32_t tail = atomic_load_explicit(&cv->blocks, memory_order_relaxed);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		if(tail - (head - 1 - i) >= MONITOR_CV_BLOCKS)
+			return i;
+	}
+
+	return n;
+}
+
+// power of ten at least 1 that recent blocks of a CV sink fit in
+static float
+_monitor_cv_scale(const monitor_block_t *blocks, unsigned n)
+{
+	float peak = 0.f;
+	float scale = 1.f;
+
+	for(unsigned i = 0; i < n; i++)
+		peak = NK_MAX(peak, NK_MAX(NK_ABS(blocks[i].min), NK_ABS(blocks[i].max)));
+
+	while( (scale < peak) && (scale < 1e6f) )
+		scale *= 10.f;
+
+	return scale;
+}
+
+// min to max of newest block of a CV sink from center, mean as marker
+static void
+_monitor_block_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	const monitor_block_t *block, float scale, struct nk_rect outline)
+{
+	const float line = ctx->style.window.group_border;
+	const float cx = outline.x + outline.w/2;
+	const float amp = outline.w/2;
+	const float min = NK_CLAMP(-1.f, block->min / scale, 1.f);
+	const float max = NK_CLAMP(-1.f, block->max / scale, 1.f);
+	const float mean = NK_CLAMP(-1.f, block->mean / scale, 1.f);
+
+	nk_fill_rect(canvas, nk_rect(cx + min*amp, outline.y, (max - min)*amp, outline.h),
+		0.f, nk_rgba(0x00, 0xff, 0xff, 0x7f));
+	nk_stroke_line(canvas, cx, outline.y, cx, outline.y + outline.h,
+		line, ctx->style.window.group_border_color);
+	nk_stroke_line(canvas, cx + mean*amp, outline.y, cx + mean*amp, outline.y + outline.h,
+		2.f * line, hilight_color);
+}
+
+// scale and recent blocks of a sink below the node
+static void
+_monitor_blocks_draw(struct nk_context *ctx, struct nk_command_buffer *canvas,
+	const monitor_block_t *blocks, unsigned n, unsigned j, float scale,
+	struct nk_rect body)
+{
+	char lines [1 + MONITOR_CV_BLOCKS][80];
+	unsigned nlines = 0;
+
+	snprintf(lines[nlines++], 80, "sink %u: -%g to %g", j + 1, scale, scale);
+
+	for(unsigned i = 0; i < n; i++)
+	{
+		snprintf(lines[nlines++], 80, "min %+.4f, mean %+.4f, max %+.4f",
+			blocks[i].min, blocks[i].mean, blocks[i].max);
+	}
+
+	_monitor_lines_draw(ctx, canvas, lines, nlines, body);
+}
+
 static void
 node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 {
@@ -483,10 +1290,48 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 	if(atomic_load_explicit(&shm->closing, memory_order_acquire))
 		return;
 
+	if(atomic_load_explicit(&shm->gen, memory_order_acquire) & 1) // resizing
+	{
+		app->animating = true;
+		return;
+	}
+
+	if(shm->header.size != client->shm_size) // segment has grown, map it anew
+	{
+		_monitor_free(shm, client->shm_size);
+		shm = client->monitor_shm = _monitor_add(client->name, &client->shm_size);
+		if(!shm)
+			return;
+	}
+
 	const float ps = 24.f * app->scale;
-	const unsigned ny = shm->nsinks;
+	const unsigned ny = shm->header.nsinks;
+
+	if(!_monitor_levels_update(client, shm, ny))
+		return;
 
-	client->dim.x = 6 * ps;
+	const port_type_t type = shm->header.type;
+	const bool is_audio = (type == TYPE_AUDIO);
+#ifdef JACK_HAS_METADATA_API
+	const bool is_osc = (type == TYPE_OSC);
+	const bool is_cv = (type == TYPE_CV);
+#else
+	const bool is_osc = false;
+	const bool is_cv = false;
+#endif
+	const bool is_spectrum = is_audio && (shm->mode == MONITOR_SPECTRUM);
+	const bool is_correlation = is_audio && (shm->mode == MONITOR_CORRELATION);
+	const float mw = 6 * ps; // of meters, audio and CV have history or spectrum strips next to them
+	const float gw = is_correlation ? 2 * ps : 0.f; // of goniometers, one per pair of sinks
+	const float cw = 4 * ps; // of MIDI channel activity or OSC path, event rate next to it
+
+	client->dim.x = is_spectrum
+		? mw + 8 * ps
+		: is_audio
+			? mw + 4 * ps + gw
+			: is_cv
+				? mw + 6 * ps
+				: mw + cw + 3 * ps;
 	client->dim.y = ny * ps;
 
 	struct nk_rect bounds = nk_rect(
@@ -496,6 +1341,7 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 
 	if(_client_moveable(ctx, app, client, &bounds))
 	{
+		atomic_store_explicit(&shm->closing, true, memory_order_release);
 		sem_post(&shm->done);
 	}
 
@@ -503,6 +1349,18 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 		&& !nodedit->linking.active;
 	const bool is_hilighted = client->hilighted || client->hovered || client->moving;
 
+	if(  client->hovered
+		&& nk_input_is_key_down(in, NK_KEY_CTRL)
+		&& (in->mouse.scroll_delta.y != 0.f) ) // resize sinks
+	{
+		const int nsinks = ny + ( (in->mouse.scroll_delta.y > 0.f) ? 1 : -1);
+
+		in->mouse.scroll_delta.y = 0.f;
+
+		if(nsinks > 0)
+			_shm_resize_request(&shm->resize, &shm->done, nsinks, 0);
+	}
+
 	nk_layout_space_push(ctx, nk_layout_space_rect_to_local(ctx, bounds));
 
 	struct nk_rect body;
@@ -513,14 +1371,15 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 
 		nk_fill_rect(canvas, body, style->rounding, style->hover.data.color);
 
-		if(client->sink_type == TYPE_AUDIO)
+		if(is_audio)
 		{
+			const uint32_t head = atomic_load_explicit(&shm->history, memory_order_acquire);
+
 			for(unsigned j = 0; j < ny; j++)
 			{
-				const int32_t mBFS = atomic_load_explicit(&shm->jgains[j], memory_order_relaxed);
-				const float dBFS = mBFS / 100.f;
+				const float dBFS = client->levels[j*MONITOR_SLOTS];
 
-				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
+				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, mw, ps);
 				struct nk_rect tile = orig;
 				struct nk_rect outline;
 				const float mx1 = 58.f / 70.f;
@@ -582,17 +1441,47 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 					nk_stroke_line(canvas, x0, y0, x1, y1, border, ctx->style.window.group_border_color);
 				}
 
+				// sample peak or short-term loudness as marker
+				const float e2 = (client->levels[j*MONITOR_SLOTS + 1] + 64.f) / 70.f;
+
+				if( (shm->mode != MONITOR_PEAK) && !is_spectrum && (e2 > 0.f) )
+				{
+					const float x0 = outline.x + outline.w * NK_MIN(e2, 1.f);
+
+					nk_stroke_line(canvas, x0, outline.y, x0, outline.y + outline.h,
+						2.f * ctx->style.window.group_border, hilight_color);
+				}
+
 				nk_stroke_rect(canvas, outline, 0.f, ctx->style.window.group_border, ctx->style.window.group_border_color);
+
+				const struct nk_rect strip = nk_rect(body.x + mw, outline.y,
+					body.w - mw - gw - (outline.x - body.x), outline.h);
+
+				if(is_spectrum)
+					_monitor_spectrum_draw(ctx, canvas, &client->bands[j*MONITOR_BANDS], strip);
+				else
+					_monitor_history_draw(ctx, canvas, shm, ny, j, head, 1.f, strip);
+			}
+
+			const unsigned npairs = NK_MIN(shm->npairs, ny/2);
+			const float inset = ctx->style.property.border + ctx->style.property.padding.y;
+
+			for(unsigned p = 0; p < npairs; p++)
+			{
+				const struct nk_rect box = nk_rect(body.x + body.w - gw + inset,
+					body.y + 2*p*ps + inset, gw - 2*inset, 2*ps - 2*inset);
+
+				_monitor_pair_draw(ctx, canvas, _monitor_shm_pair(shm, ny, p), box);
 			}
 		}
-		else if(client->sink_type == TYPE_MIDI)
+		else if(type == TYPE_MIDI)
 		{
 			for(unsigned j = 0; j < ny; j++)
 			{
-				const int32_t cvel = atomic_load_explicit(&shm->jgains[j], memory_order_relaxed);
-				const float vel = cvel / 100.f;
+				const float vel = client->levels[j*MONITOR_SLOTS];
+				const monitor_rate_t *rate = &client->rates[j];
 
-				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
+				struct nk_rect orig = nk_rect(body.x, body.y + j*ps, mw, ps);
 				struct nk_rect tile = orig;
 				struct nk_rect outline;
 				const float mx1 = 1.f;
@@ -637,6 +1526,129 @@ node_editor_monitor(struct nk_context *ctx, app_t *app, client_t *client)
 				}
 
 				nk_stroke_rect(canvas, outline, 0.f, ctx->style.window.group_border, ctx->style.window.group_border_color);
+
+				_monitor_channels_draw(ctx, canvas, rate,
+					nk_rect(body.x + mw, outline.y, cw, outline.h));
+
+				{
+					char tmp [32];
+					const struct nk_user_font *font = ctx->style.font;
+					const size_t tmp_len = snprintf(tmp, 32, "%.0f/s", rate->event_rate);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const struct nk_rect body2 = nk_rect(body.x + body.w - fw - (outline.x - body.x),
+						orig.y + (orig.h - font->height)/2, fw, font->height);
+
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+			}
+
+			if(client->hovered && !client->moving)
+			{
+				const float y = in->mouse.pos.y - body.y;
+				const unsigned j = NK_CLAMP(0.f, y / ps, ny - 1);
+
+				_monitor_events_draw(ctx, canvas, shm, ny, j, &client->rates[j], body);
+			}
+		}
+		else if(is_osc)
+		{
+			const struct nk_user_font *font = ctx->style.font;
+			const float ox = font->height/2 + ctx->style.property.border + ctx->style.property.padding.x;
+			const float oy = ctx->style.property.border + ctx->style.property.padding.y;
+			monitor_path_t paths [MONITOR_PATHS];
+
+			for(unsigned j = 0; j < ny; j++)
+			{
+				const monitor_rate_t *rate = &client->rates[j];
+				const struct nk_rect orig = nk_rect(body.x, body.y + j*ps, body.w, ps);
+				const struct nk_rect cell = nk_rect(orig.x + ox, orig.y + oy, ps - 2*oy, ps - 2*oy);
+				const uint8_t alph = 0x1f + 0xc0 * rate->channels[0];
+
+				// message activity
+				nk_fill_rect(canvas, cell, 0.f, nk_rgba(0x00, 0xff, 0xff, alph));
+				nk_stroke_rect(canvas, cell, 0.f, ctx->style.window.group_border,
+					ctx->style.window.group_border_color);
+
+				char tmp [32];
+				const size_t tmp_len = snprintf(tmp, 32, "%.0f/s", rate->event_rate);
+				const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+				const float ty = orig.y + (orig.h - font->height)/2;
+
+				nk_draw_text(canvas, nk_rect(orig.x + orig.w - fw - ox, ty, fw, font->height),
+					tmp, tmp_len, font, style->normal.data.color, style->text_normal);
+
+				// newest path, cut short to fit in between
+				if(_monitor_paths_get(_monitor_shm_osc(shm, ny, j), paths))
+				{
+					const float px = cell.x + cell.w + ox;
+					const float pw = orig.x + orig.w - fw - 2*ox - px;
+					size_t len = strlen(paths[0].path);
+
+					while( (len > 0) && (font->width(font->userdata, font->height,
+						paths[0].path, len) > pw) )
+					{
+						len--;
+					}
+
+					nk_draw_text(canvas, nk_rect(px, ty, pw, font->height), paths[0].path, len,
+						font, style->normal.data.color, style->text_normal);
+				}
+			}
+
+			if(client->hovered && !client->moving)
+			{
+				const float y = in->mouse.pos.y - body.y;
+				const unsigned j = NK_CLAMP(0.f, y / ps, ny - 1);
+
+				_monitor_paths_draw(ctx, canvas, shm, ny, j, &client->rates[j], body);
+			}
+		}
+		else if(is_cv)
+		{
+			const struct nk_user_font *font = ctx->style.font;
+			const float ox = font->height/2 + ctx->style.property.border + ctx->style.property.padding.x;
+			const float oy = ctx->style.property.border + ctx->style.property.padding.y;
+			const uint32_t head = atomic_load_explicit(&shm->history, memory_order_acquire);
+			monitor_block_t blocks [MONITOR_CV_BLOCKS];
+
+			for(unsigned j = 0; j < ny; j++)
+			{
+				const unsigned n = _monitor_blocks_get(_monitor_shm_cv(shm, ny, j), blocks);
+				const float scale = _monitor_cv_scale(blocks, n);
+				const struct nk_rect orig = nk_rect(body.x, body.y + j*ps, mw, ps);
+				const struct nk_rect outline = nk_rect(orig.x + ox, orig.y + oy,
+					orig.w - 2*ox, orig.h - 2*oy);
+
+				if(n)
+					_monitor_block_draw(ctx, canvas, &blocks[0], scale, outline);
+
+				nk_stroke_rect(canvas, outline, 0.f, ctx->style.window.group_border,
+					ctx->style.window.group_border_color);
+
+				_monitor_history_draw(ctx, canvas, shm, ny, j, head, scale,
+					nk_rect(body.x + mw, outline.y, 4 * ps, outline.h));
+
+				if(n)
+				{
+					char tmp [32];
+					const size_t tmp_len = snprintf(tmp, 32, "%+.3g", blocks[0].mean);
+					const float fw = font->width(font->userdata, font->height, tmp, tmp_len);
+					const struct nk_rect body2 = nk_rect(body.x + body.w - fw - ox,
+						orig.y + (orig.h - font->height)/2, fw, font->height);
+
+					nk_draw_text(canvas, body2, tmp, tmp_len, font,
+						style->normal.data.color, style->text_normal);
+				}
+			}
+
+			if(client->hovered && !client->moving)
+			{
+				const float y = in->mouse.pos.y - body.y;
+				const unsigned j = NK_CLAMP(0.f, y / ps, ny - 1);
+				const unsigned n = _monitor_blocks_get(_monitor_shm_cv(shm, ny, j), blocks);
+
+				_monitor_blocks_draw(ctx, canvas, blocks, n, j, _monitor_cv_scale(blocks, n), body);
 			}
 		}
 
@@ -1191,21 +2203,22 @@ _expose(struct nk_context *ctx, struct nk_rect wbounds, void *data)
 			}
 
 			// contextual menu
-			if(
-#ifdef JACK_HAS_METADATA_API
-				(app->type != TYPE_OSC) && (app->type != TYPE_CV) &&
-#endif
-				nk_contextual_begin(ctx, 0, nk_vec2(100, 360), total_space))
+			if(nk_contextual_begin(ctx, 0, nk_vec2(100, 360), total_space))
 			{
 				nk_layout_row_dynamic(ctx, app->dy, 1);
-				if(nk_contextual_item_label(ctx, "Mixer 1x1", NK_TEXT_LEFT))
-					_mixer_spawn(app, 1, 1);
-				if(nk_contextual_item_label(ctx, "Mixer 2x2", NK_TEXT_LEFT))
-					_mixer_spawn(app, 2, 2);
-				if(nk_contextual_item_label(ctx, "Mixer 4x4", NK_TEXT_LEFT))
-					_mixer_spawn(app, 4, 4);
-				if(nk_contextual_item_label(ctx, "Mixer 8x8", NK_TEXT_LEFT))
-					_mixer_spawn(app, 8, 8);
+#ifdef JACK_HAS_METADATA_API
+				if(app->type != TYPE_OSC)
+#endif
+				{
+					if(nk_contextual_item_label(ctx, "Mixer 1x1", NK_TEXT_LEFT))
+						_mixer_spawn(app, 1, 1);
+					if(nk_contextual_item_label(ctx, "Mixer 2x2", NK_TEXT_LEFT))
+						_mixer_spawn(app, 2, 2);
+					if(nk_contextual_item_label(ctx, "Mixer 4x4", NK_TEXT_LEFT))
+						_mixer_spawn(app, 4, 4);
+					if(nk_contextual_item_label(ctx, "Mixer 8x8", NK_TEXT_LEFT))
+						_mixer_spawn(app, 8, 8);
+				}
 				if(nk_contextual_item_label(ctx, "Monitor x1", NK_TEXT_LEFT))
 					_monitor_spawn(app, 1);
 				if(nk_contextual_item_label(ctx, "Monitor x2", NK_TEXT_LEFT))